@@ -128,3 +128,50 @@ void spill_drunk_water(char *tiles, const size_t w, const size_t h,
   }
 }
 
+
+void run_cellular(char *tiles, const size_t w, const size_t h, const size_t num_iter)
+{
+  char *scratch = new char[w * h];
+  memcpy(scratch, tiles, w * h);
+  for (size_t iter = 0; iter < num_iter; ++iter)
+  {
+    bool hasChanges = false;
+    for (int y = 0; y < int(h); ++y)
+      for (int x = 0; x < int(w); ++x)
+      {
+        size_t numWalls1 = 0;
+        size_t numWalls2 = 0;
+        for (int yy = y - 1; yy < y + 2; ++yy)
+          for (int xx = x - 1; xx < x + 2; ++xx)
+            numWalls1 += yy < 0 || xx < 0 || yy >= int(h) || xx >= int(w) || tiles[size_t(yy) * w + size_t(xx)] == dungeon::wall;
+        for (int yy = y - 2; yy < y + 3; ++yy)
+          for (int xx = x - 2; xx < x + 3; ++xx)
+            numWalls2 += yy < 0 || xx < 0 || yy >= int(h) || xx >= int(w) || tiles[size_t(yy) * w + size_t(xx)] == dungeon::wall;
+
+        const bool shouldBeWall = numWalls1 >= 5 || numWalls2 < 1;
+        const bool shouldFlip = shouldBeWall != (tiles[size_t(y) * w + size_t(x)] == dungeon::wall);
+        if (shouldFlip)
+          scratch[size_t(y) * w + size_t(x)] = shouldBeWall ? dungeon::wall : dungeon::floor;
+        hasChanges |= shouldFlip;
+      }
+    memcpy(tiles, scratch, w * h);
+    if (!hasChanges)
+      break;
+  }
+  delete[] scratch;
+}
+
+void gen_cellular_dungeon(char *tiles, const size_t w, const size_t h, const float fillrate, const size_t num_iter)
+{
+  memset(tiles, dungeon::wall, w * h);
+
+  // from https://en.cppreference.com/w/cpp/numeric/random/uniform_real_distribution
+  std::random_device rd;  // Will be used to obtain a seed for the random number engine
+  std::mt19937 gen(rd()); // Standard mersenne_twister_engine seeded with rd()
+  std::uniform_real_distribution<float> dis(0.f, 1.f);
+  for (size_t y = 0; y < h; ++y)
+    for (size_t x = 0; x < w; ++x)
+      tiles[y * w + x] = dis(gen) < fillrate ? dungeon::wall : dungeon::floor;
+
+  run_cellular(tiles, w, h, num_iter);
+}
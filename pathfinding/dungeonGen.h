@@ -6,3 +6,7 @@ void gen_drunk_dungeon(char *tiles, const size_t w, const size_t h,
 
 void spill_drunk_water(char *tiles, const size_t w, const size_t h,
                        const size_t num_iter, const size_t max_spills);
+
+// cellular automata caves, same as in w8
+void gen_cellular_dungeon(char *tiles, const size_t w, const size_t h, const float fillrate, const size_t num_iter);
+void run_cellular(char *tiles, const size_t w, const size_t h, const size_t num_iter);
@@ -0,0 +1,117 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Binary min-heap over node indices [0, capacity) which remembers where every node
+// sits in the heap, so membership is O(1) and decreasing a key is O(log n)
+// instead of a linear scan over the open list.
+// Equal keys come out in the order nodes were inserted, like a first-minimum scan over a list would.
+class IndexedHeap
+{
+public:
+  static constexpr uint32_t npos = ~0u;
+
+  void reset(size_t capacity)
+  {
+    heap.clear();
+    heapPos.assign(capacity, npos);
+    nextOrder = 0;
+  }
+
+  bool empty() const { return heap.empty(); }
+  size_t size() const { return heap.size(); }
+  bool contains(size_t node) const { return heapPos[node] != npos; }
+
+  float top_key() const { return heap.front().key; }
+  size_t top() const { return heap.front().node; }
+
+  // inserts the node or moves it up if the new key is lower
+  void push(size_t node, float key)
+  {
+    uint32_t pos = heapPos[node];
+    if (pos == npos)
+    {
+      pos = uint32_t(heap.size());
+      heap.push_back({key, nextOrder++, uint32_t(node)});
+      heapPos[node] = pos;
+    }
+    else if (key < heap[pos].key)
+      heap[pos].key = key;
+    else
+      return;
+    sift_up(pos);
+  }
+
+  size_t pop()
+  {
+    const size_t node = heap.front().node;
+    heapPos[node] = npos;
+    if (heap.size() > 1)
+    {
+      heap.front() = heap.back();
+      heapPos[heap.front().node] = 0;
+      heap.pop_back();
+      sift_down(0);
+    }
+    else
+      heap.pop_back();
+    return node;
+  }
+
+private:
+  struct Entry
+  {
+    float key;
+    uint32_t order; // insertion order, breaks ties between equal keys
+    uint32_t node;
+  };
+
+  static bool less(const Entry &lhs, const Entry &rhs)
+  {
+    return lhs.key < rhs.key || (!(rhs.key < lhs.key) && lhs.order < rhs.order);
+  }
+
+  void place(uint32_t pos, const Entry &e)
+  {
+    heap[pos] = e;
+    heapPos[e.node] = pos;
+  }
+
+  void sift_up(uint32_t pos)
+  {
+    const Entry e = heap[pos];
+    while (pos > 0)
+    {
+      const uint32_t parent = (pos - 1) / 2;
+      if (!less(e, heap[parent]))
+        break;
+      place(pos, heap[parent]);
+      pos = parent;
+    }
+    place(pos, e);
+  }
+
+  void sift_down(uint32_t pos)
+  {
+    const Entry e = heap[pos];
+    const uint32_t count = uint32_t(heap.size());
+    while (true)
+    {
+      uint32_t child = pos * 2 + 1;
+      if (child >= count)
+        break;
+      if (child + 1 < count && less(heap[child + 1], heap[child]))
+        ++child;
+      if (!less(heap[child], e))
+        break;
+      place(pos, heap[child]);
+      pos = child;
+    }
+    place(pos, e);
+  }
+
+  std::vector<Entry> heap;
+  std::vector<uint32_t> heapPos;
+  uint32_t nextOrder = 0;
+};
@@ -6,7 +6,11 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <cassert>
 #include "math.h"
+#include "indexedHeap.h"
 #include "dungeonGen.h"
 #include "dungeonUtils.h"
 
@@ -38,15 +42,16 @@ static void draw_path(std::vector<Position> path)
   }
 }
 
-static std::vector<Position> reconstruct_path(std::vector<Position> prev, Position to, size_t width)
+static std::vector<Position> reconstruct_path(const std::vector<Position> &prev, Position to, size_t width)
 {
   Position curPos = to;
   std::vector<Position> res = {curPos};
   while (prev[coord_to_idx(curPos.x, curPos.y, width)] != Position{-1, -1})
   {
     curPos = prev[coord_to_idx(curPos.x, curPos.y, width)];
-    res.insert(res.begin(), curPos);
+    res.push_back(curPos);
   }
+  std::reverse(res.begin(), res.end());
   return res;
 }
 
@@ -55,35 +60,82 @@ float heuristic(Position lhs, Position rhs)
   return sqrtf(square(float(lhs.x - rhs.x)) + square(float(lhs.y - rhs.y)));
 };
 
-static float ida_star_search(const char *input, size_t width, size_t height, std::vector<Position> &path, const float g, const float bound, Position to)
+// Fixed size table of the best g seen per tile during the current IDA* iteration, a tile reached
+// again no cheaper than before has its subtree already searched under this bound.
+// Entries are tagged with the iteration so it never needs clearing, collisions just overwrite.
+class IdaTranspositionTable
 {
-  const Position &p = path.back();
-  const float f = g + heuristic(p, to);
+public:
+  explicit IdaTranspositionTable(size_t size_log2) : entries(size_t(1) << size_log2), shift(32 - uint32_t(size_log2)) {}
+
+  void next_iteration() { iteration++; }
+
+  // true if the tile was already reached with g no larger than this one, records g otherwise
+  bool check_and_store(size_t idx, float g)
+  {
+    Entry &e = entries[(uint32_t(idx) * 0x9e3779b1u) >> shift];
+    if (e.iteration == iteration && e.tile == uint32_t(idx) && e.g <= g)
+      return true;
+    e = {uint32_t(idx), iteration, g};
+    return false;
+  }
+
+private:
+  struct Entry
+  {
+    uint32_t tile = 0;
+    uint32_t iteration = 0;
+    float g = 0.f;
+  };
+  std::vector<Entry> entries;
+  uint32_t shift = 0;
+  uint32_t iteration = 0;
+};
+
+struct IdaStarContext
+{
+  const char *input;
+  size_t width;
+  size_t height;
+  Position to;
+  std::vector<Position> path;
+  std::vector<bool> onPath; // bitmap of path tiles, instead of searching the path for cycles
+  IdaTranspositionTable *table = nullptr;
+};
+
+static float ida_star_search(IdaStarContext &ctx, const float g, const float bound)
+{
+  const Position p = ctx.path.back();
+  const float f = g + heuristic(p, ctx.to);
   if (f > bound)
     return f;
-  if (p == to)
+  if (p == ctx.to)
     return -f;
   float min = FLT_MAX;
   auto checkNeighbour = [&](Position p) -> float
   {
     // out of bounds
-    if (p.x < 0 || p.y < 0 || p.x >= int(width) || p.y >= int(height))
+    if (p.x < 0 || p.y < 0 || p.x >= int(ctx.width) || p.y >= int(ctx.height))
       return 0.f;
-    size_t idx = coord_to_idx(p.x, p.y, width);
+    size_t idx = coord_to_idx(p.x, p.y, ctx.width);
     // not empty
-    if (input[idx] == '#')
+    if (ctx.input[idx] == '#')
       return 0.f;
-    if (std::find(path.begin(), path.end(), p) != path.end())
+    if (ctx.onPath[idx])
       return 0.f;
-    path.push_back(p);
-    float weight = input[idx] == 'o' ? 10.f : 1.f;
+    float weight = ctx.input[idx] == 'o' ? 10.f : 1.f;
     float gScore = g + 1.f * weight; // we're exactly 1 unit away
-    const float t = ida_star_search(input, width, height, path, gScore, bound, to);
+    if (ctx.table && ctx.table->check_and_store(idx, gScore))
+      return 0.f;
+    ctx.path.push_back(p);
+    ctx.onPath[idx] = true;
+    const float t = ida_star_search(ctx, gScore, bound);
     if (t < 0.f)
       return t;
     if (t < min)
       min = t;
-    path.pop_back();
+    ctx.path.pop_back();
+    ctx.onPath[idx] = false;
     return t;
   };
   float lv = checkNeighbour({p.x + 1, p.y + 0});
@@ -97,15 +149,31 @@ static float ida_star_search(const char *input, size_t width, size_t height, std
   return min;
 }
 
-static std::vector<Position> find_ida_star_path(const char *input, size_t width, size_t height, Position from, Position to)
+// Low memory fallback for maps where the A* open list gets too big: a bit per tile plus
+// an optional transposition table of 2^table_size_log2 entries (0 to go without one).
+static std::vector<Position> find_ida_star_path(const char *input, size_t width, size_t height, Position from, Position to,
+                                                size_t table_size_log2 = 16)
 {
+  if (from.x < 0 || from.y < 0 || from.x >= int(width) || from.y >= int(height))
+    return {};
+  // found paths are returned as -f, which doesn't work for f == 0
+  if (from == to)
+    return {from};
+  IdaTranspositionTable table(std::max(table_size_log2, size_t(1)));
+  IdaStarContext ctx{input, width, height, to, {from}, std::vector<bool>(width * height, false),
+                     table_size_log2 > 0 ? &table : nullptr};
+  ctx.onPath[coord_to_idx(from.x, from.y, width)] = true;
   float bound = heuristic(from, to);
-  std::vector<Position> path = {from};
   while (true)
   {
-    const float t = ida_star_search(input, width, height, path, 0.f, bound, to);
+    if (ctx.table)
+    {
+      ctx.table->next_iteration();
+      ctx.table->check_and_store(coord_to_idx(from.x, from.y, width), 0.f);
+    }
+    const float t = ida_star_search(ctx, 0.f, bound);
     if (t < 0.f)
-      return path;
+      return ctx.path;
     if (t == FLT_MAX)
       return {};
     bound = t;
@@ -114,82 +182,624 @@ static std::vector<Position> find_ida_star_path(const char *input, size_t width,
   return {};
 }
 
-static std::vector<Position> find_path_a_star(const char *input, size_t width, size_t height, Position from, Position to, float weight)
+// filled by searches when given, benchmarks also turn off drawing of expanded nodes with it
+struct SearchStats
+{
+  size_t nodesExpanded = 0;
+  bool drawExpanded = true;
+};
+
+static void draw_expanded(Position p, float g, const SearchStats *stats)
+{
+  if (stats && !stats->drawExpanded)
+    return;
+  const Rectangle rect = {float(p.x), float(p.y), 1.f, 1.f};
+  DrawRectangleRec(rect, Color{uint8_t(g), uint8_t(g), 0, 100});
+}
+
+static std::vector<Position> find_path_a_star(const char *input, size_t width, size_t height, Position from, Position to, float weight,
+                                              SearchStats *stats = nullptr)
 {
   if (from.x < 0 || from.y < 0 || from.x >= int(width) || from.y >= int(height))
     return std::vector<Position>();
   size_t inpSize = width * height;
 
   std::vector<float> g(inpSize, std::numeric_limits<float>::max());
-  std::vector<float> f(inpSize, std::numeric_limits<float>::max());
   std::vector<Position> prev(inpSize, {-1,-1});
+  std::vector<bool> closed(inpSize, false);
+  IndexedHeap openList;
+  openList.reset(inpSize);
+
+  const size_t fromIdx = coord_to_idx(from.x, from.y, width);
+  g[fromIdx] = 0;
+  openList.push(fromIdx, weight * heuristic(from, to));
+
+  while (!openList.empty())
+  {
+    const size_t idx = openList.pop();
+    const Position curPos{int(idx % width), int(idx / width)};
+    if (curPos == to)
+      return reconstruct_path(prev, to, width);
+    draw_expanded(curPos, g[idx], stats);
+    if (stats)
+      stats->nodesExpanded++;
+    closed[idx] = true;
+    auto checkNeighbour = [&](Position p)
+    {
+      // out of bounds
+      if (p.x < 0 || p.y < 0 || p.x >= int(width) || p.y >= int(height))
+        return;
+      size_t nidx = coord_to_idx(p.x, p.y, width);
+      // not empty
+      if (input[nidx] == '#')
+        return;
+      float edgeWeight = input[nidx] == 'o' ? 10.f : 1.f;
+      float gScore = g[idx] + 1.f * edgeWeight; // we're exactly 1 unit away
+      if (gScore < g[nidx])
+      {
+        // closed nodes still take the better parent, they just aren't expanded again
+        prev[nidx] = curPos;
+        g[nidx] = gScore;
+        if (!closed[nidx])
+          openList.push(nidx, gScore + weight * heuristic(p, to));
+      }
+    };
+    checkNeighbour({curPos.x + 1, curPos.y + 0});
+    checkNeighbour({curPos.x - 1, curPos.y + 0});
+    checkNeighbour({curPos.x + 0, curPos.y + 1});
+    checkNeighbour({curPos.x + 0, curPos.y - 1});
+  }
+  // empty path
+  return std::vector<Position>();
+}
+
+static bool is_tile_free(const char *input, size_t width, size_t height, int x, int y)
+{
+  return x >= 0 && y >= 0 && x < int(width) && y < int(height) && input[coord_to_idx(x, y, width)] != '#';
+}
 
-  auto getG = [&](Position p) -> float { return g[coord_to_idx(p.x, p.y, width)]; };
-  auto getF = [&](Position p) -> float { return f[coord_to_idx(p.x, p.y, width)]; };
+// Jump results for whole runs of free tiles in rows and columns (JPS+ style), filled lazily
+// so every straight scan is O(1) once its run has been seen. Goal isn't baked in, it's checked
+// against the run separately, so the cache is reused by all searches until the map changes.
+class JumpCache
+{
+public:
+  JumpCache(const char *inp, size_t w, size_t h) : input(inp), width(w), height(h), rows(w * h), cols(w * h) {}
+
+  // has to be called after any change of the map
+  void reset()
+  {
+    rows.assign(width * height, Run());
+    cols.assign(width * height, Run());
+  }
 
-  g[coord_to_idx(from.x, from.y, width)] = 0;
-  f[coord_to_idx(from.x, from.y, width)] = weight * heuristic(from, to);
+  bool is_free(int x, int y) const { return is_tile_free(input, width, height, x, y); }
 
-  std::vector<Position> openList = {from};
-  std::vector<Position> closedList;
+  // first jump point from p going in (dx, dy), or {-1, -1}
+  Position jump(Position p, int dx, int dy, Position to)
+  {
+    const Position start{p.x + dx, p.y + dy};
+    if (!is_free(start.x, start.y))
+      return Position{-1, -1};
+    if (dx != 0)
+    {
+      const Run &run = get_row_run(start.x, start.y);
+      const int stop = dx > 0 ? run.stopFwd : run.stopBack;
+      const int limit = dx > 0 ? run.end : run.start;
+      if (to.y == start.y && (to.x - start.x) * dx >= 0 && (limit - to.x) * dx >= 0 && (stop < 0 || (stop - to.x) * dx > 0))
+        return to;
+      return stop < 0 ? Position{-1, -1} : Position{stop, start.y};
+    }
+    const Run &run = get_col_run(start.x, start.y);
+    int stop = dy > 0 ? run.stopFwd : run.stopBack;
+    const int limit = dy > 0 ? run.end : run.start;
+    auto closer = [&](int y) { return (y - start.y) * dy >= 0 && (limit - y) * dy >= 0 && (stop < 0 || (stop - y) * dy > 0); };
+    // goal in the column, or a horizontal scan from the column would reach it
+    if (to.x == start.x && closer(to.y))
+      return to;
+    if (closer(to.y) && to.x != start.x && is_free(to.x, to.y))
+    {
+      const Run &goalRun = get_row_run(to.x, to.y);
+      if (start.x >= goalRun.start && start.x <= goalRun.end)
+        stop = to.y;
+    }
+    return stop < 0 ? Position{-1, -1} : Position{start.x, stop};
+  }
+
+private:
+  struct Run
+  {
+    int start = -1; // -1 until processed
+    int end = -1;
+    int stopFwd = -1; // closest stop going right/down, tile itself included, -1 if none
+    int stopBack = -1;
+  };
+
+  // a wall corner behind the tile opens a new way to the side
+  bool is_row_corner(int x, int y, int dx) const
+  {
+    return (is_free(x, y - 1) && !is_free(x - dx, y - 1)) || (is_free(x, y + 1) && !is_free(x - dx, y + 1));
+  }
+  bool is_col_stop(int x, int y, int dy)
+  {
+    if ((is_free(x - 1, y) && !is_free(x - 1, y - dy)) || (is_free(x + 1, y) && !is_free(x + 1, y - dy)))
+      return true;
+    // horizontal scans from every tile of a vertical one
+    return (is_free(x + 1, y) && get_row_run(x + 1, y).stopFwd >= 0) ||
+           (is_free(x - 1, y) && get_row_run(x - 1, y).stopBack >= 0);
+  }
+
+  const Run &get_row_run(int x, int y)
+  {
+    const size_t idx = coord_to_idx(x, y, width);
+    if (rows[idx].start >= 0)
+      return rows[idx];
+    int start = x;
+    int end = x;
+    while (is_free(start - 1, y))
+      --start;
+    while (is_free(end + 1, y))
+      ++end;
+    const size_t rowIdx = coord_to_idx(0, y, width);
+    for (int xx = start; xx <= end; ++xx)
+    {
+      Run &run = rows[rowIdx + size_t(xx)];
+      run.start = start;
+      run.end = end;
+      run.stopBack = is_row_corner(xx, y, -1) ? xx : xx > start ? rows[rowIdx + size_t(xx - 1)].stopBack : -1;
+    }
+    for (int xx = end; xx >= start; --xx)
+      rows[rowIdx + size_t(xx)].stopFwd = is_row_corner(xx, y, 1) ? xx : xx < end ? rows[rowIdx + size_t(xx + 1)].stopFwd : -1;
+    return rows[idx];
+  }
+
+  const Run &get_col_run(int x, int y)
+  {
+    const size_t idx = coord_to_idx(x, y, width);
+    if (cols[idx].start >= 0)
+      return cols[idx];
+    int start = y;
+    int end = y;
+    while (is_free(x, start - 1))
+      --start;
+    while (is_free(x, end + 1))
+      ++end;
+    for (int yy = start; yy <= end; ++yy)
+    {
+      Run &run = cols[coord_to_idx(x, yy, width)];
+      run.start = start;
+      run.end = end;
+      run.stopBack = is_col_stop(x, yy, -1) ? yy : yy > start ? cols[coord_to_idx(x, yy - 1, width)].stopBack : -1;
+    }
+    for (int yy = end; yy >= start; --yy)
+      cols[coord_to_idx(x, yy, width)].stopFwd =
+        is_col_stop(x, yy, 1) ? yy : yy < end ? cols[coord_to_idx(x, yy + 1, width)].stopFwd : -1;
+    return cols[idx];
+  }
+
+  const char *input;
+  size_t width;
+  size_t height;
+  std::vector<Run> rows;
+  std::vector<Run> cols;
+};
+
+// Jump point search for 4-connected uniform cost grids, only jump points get into the open list.
+// Same output as find_path_a_star, segments between jump points are filled in on reconstruction.
+static std::vector<Position> find_path_jps(const char * /*input*/, size_t width, size_t height, Position from, Position to, float weight,
+                                           JumpCache &jumps, SearchStats *stats = nullptr)
+{
+  if (from.x < 0 || from.y < 0 || from.x >= int(width) || from.y >= int(height))
+    return std::vector<Position>();
+  size_t inpSize = width * height;
+
+  std::vector<float> g(inpSize, std::numeric_limits<float>::max());
+  std::vector<Position> prev(inpSize, {-1,-1});
+  std::vector<bool> closed(inpSize, false);
+  IndexedHeap openList;
+  openList.reset(inpSize);
+
+  const size_t fromIdx = coord_to_idx(from.x, from.y, width);
+  g[fromIdx] = 0;
+  openList.push(fromIdx, weight * heuristic(from, to));
 
   while (!openList.empty())
   {
-    size_t bestIdx = 0;
-    float bestScore = getF(openList[0]);
-    for (size_t i = 1; i < openList.size(); ++i)
+    const size_t idx = openList.pop();
+    const Position curPos{int(idx % width), int(idx / width)};
+    if (curPos == to)
     {
-      float score = getF(openList[i]);
-      if (score < bestScore)
+      std::vector<Position> jumpPoints = reconstruct_path(prev, to, width);
+      std::vector<Position> res = {jumpPoints[0]};
+      for (size_t i = 1; i < jumpPoints.size(); ++i)
       {
-        bestIdx = i;
-        bestScore = score;
+        const Position delta = jumpPoints[i] - jumpPoints[i - 1];
+        const Position dir{(delta.x > 0) - (delta.x < 0), (delta.y > 0) - (delta.y < 0)};
+        for (Position p = jumpPoints[i - 1]; p != jumpPoints[i];)
+        {
+          p = Position{p.x + dir.x, p.y + dir.y};
+          res.push_back(p);
+        }
       }
+      return res;
     }
-    if (openList[bestIdx] == to)
-      return reconstruct_path(prev, to, width);
-    Position curPos = openList[bestIdx];
-    openList.erase(openList.begin() + bestIdx);
-    if (std::find(closedList.begin(), closedList.end(), curPos) != closedList.end())
-      continue;
-    size_t idx = coord_to_idx(curPos.x, curPos.y, width);
-    const Rectangle rect = {float(curPos.x), float(curPos.y), 1.f, 1.f};
-    DrawRectangleRec(rect, Color{uint8_t(g[idx]), uint8_t(g[idx]), 0, 100});
-    closedList.emplace_back(curPos);
+    draw_expanded(curPos, g[idx], stats);
+    if (stats)
+      stats->nodesExpanded++;
+    closed[idx] = true;
+    auto checkDir = [&](int dx, int dy)
+    {
+      const Position p = jumps.jump(curPos, dx, dy, to);
+      if (p == Position{-1, -1})
+        return;
+      size_t nidx = coord_to_idx(p.x, p.y, width);
+      if (closed[nidx])
+        return;
+      float gScore = g[idx] + float(std::abs(p.x - curPos.x) + std::abs(p.y - curPos.y));
+      if (gScore < g[nidx])
+      {
+        prev[nidx] = curPos;
+        g[nidx] = gScore;
+        openList.push(nidx, gScore + weight * heuristic(p, to));
+      }
+    };
+    // prune by the direction we came from: keep going straight or turn, never go back
+    const Position parent = prev[idx];
+    const int dx = parent == Position{-1, -1} ? 0 : (curPos.x > parent.x) - (curPos.x < parent.x);
+    const int dy = parent == Position{-1, -1} ? 0 : (curPos.y > parent.y) - (curPos.y < parent.y);
+    if (dx != 0 || dy == 0)
+    {
+      checkDir(0, 1);
+      checkDir(0, -1);
+    }
+    if (dy != 0 || dx == 0)
+    {
+      checkDir(1, 0);
+      checkDir(-1, 0);
+    }
+    if (dx != 0)
+      checkDir(dx, 0);
+    if (dy != 0)
+      checkDir(0, dy);
+  }
+  // empty path
+  return std::vector<Position>();
+}
+
+// jump point search only works with uniform costs
+static bool has_weighted_tiles(const char *input, size_t width, size_t height)
+{
+  return std::find(input, input + width * height, dungeon::water) != input + width * height;
+}
+
+static std::vector<Position> find_path(const char *input, size_t width, size_t height, Position from, Position to, float weight,
+                                       JumpCache *jumps, SearchStats *stats = nullptr)
+{
+  if (jumps && !has_weighted_tiles(input, width, height))
+    return find_path_jps(input, width, height, from, to, weight, *jumps, stats);
+  return find_path_a_star(input, width, height, from, to, weight, stats);
+}
+
+// Anytime repairing A* (ARA*): finds a path quickly with an inflated heuristic, then keeps lowering
+// the weight down to 1 reusing g values from previous iterations, only tiles which got cheaper
+// after their expansion are searched again. improve() can be called every frame with a time budget.
+class AraStarSearch
+{
+public:
+  void start(const char *inp, size_t w, size_t h, Position from_pos, Position to_pos, float start_weight, float weight_step = 0.5f)
+  {
+    input = inp;
+    width = w;
+    height = h;
+    from = from_pos;
+    to = to_pos;
+    startWeight = start_weight;
+    weight = std::max(start_weight, 1.f);
+    weightStep = weight_step;
+    path.clear();
+    pathCost = std::numeric_limits<float>::max();
+    pathBound = std::numeric_limits<float>::max();
+    finished = from.x < 0 || from.y < 0 || from.x >= int(width) || from.y >= int(height) ||
+               to.x < 0 || to.y < 0 || to.x >= int(width) || to.y >= int(height);
+    if (finished)
+      return;
+
+    const size_t inpSize = width * height;
+    g.assign(inpSize, std::numeric_limits<float>::max());
+    prev.assign(inpSize, {-1, -1});
+    closedIter.assign(inpSize, 0);
+    inconsistent.assign(inpSize, false);
+    incons.clear();
+    openList.reset(inpSize);
+    iteration = 1;
+
+    const size_t fromIdx = coord_to_idx(from.x, from.y, width);
+    g[fromIdx] = 0.f;
+    openList.push(fromIdx, key(fromIdx));
+  }
+
+  // has to be called after any change of the map
+  void invalidate() { input = nullptr; }
+
+  bool is_started_for(const char *inp, Position from_pos, Position to_pos, float start_weight) const
+  {
+    return input == inp && from == from_pos && to == to_pos && startWeight == start_weight;
+  }
+
+  // runs the search for about budget_ms, returns true if a better path was found
+  bool improve(double budget_ms, SearchStats *stats = nullptr)
+  {
+    if (!input || finished)
+      return false;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(budget_ms);
+    const size_t toIdx = coord_to_idx(to.x, to.y, width);
+    bool improved = false;
+    size_t numExpanded = 0;
+    while (true)
+    {
+      // goal's key is just its g, the path is bounded by the current weight once nothing is below it
+      while (!openList.empty() && g[toIdx] > openList.top_key())
+      {
+        if ((++numExpanded & 63) == 0 && std::chrono::steady_clock::now() > deadline)
+          return improved;
+        expand(openList.pop(), stats);
+      }
+      if (g[toIdx] < pathCost)
+      {
+        path = reconstruct_path(prev, to, width);
+        pathCost = g[toIdx];
+        improved = true;
+      }
+      if (pathCost < std::numeric_limits<float>::max())
+        pathBound = std::min(weight, pathCost / std::max(min_unweighted_f(), 1e-3f));
+      if (weight <= 1.f || (openList.empty() && incons.empty()))
+      {
+        finished = true;
+        return improved;
+      }
+      weight = std::max(1.f, weight - weightStep);
+      reopen();
+    }
+  }
+
+  const std::vector<Position> &get_path() const { return path; }
+  // g of the goal when the path was found, prev links can get cheaper later so the path may be a bit better
+  float get_path_cost() const { return pathCost; }
+  // current path is at most this many times longer than the optimal one
+  float get_path_bound() const { return pathBound; }
+  bool is_finished() const { return finished; }
+
+private:
+  float key(size_t idx) const
+  {
+    return g[idx] + weight * heuristic(Position{int(idx % width), int(idx / width)}, to);
+  }
+
+  void expand(size_t idx, SearchStats *stats)
+  {
+    const Position curPos{int(idx % width), int(idx / width)};
+    draw_expanded(curPos, g[idx], stats);
+    if (stats)
+      stats->nodesExpanded++;
+    closedIter[idx] = iteration;
     auto checkNeighbour = [&](Position p)
     {
       // out of bounds
       if (p.x < 0 || p.y < 0 || p.x >= int(width) || p.y >= int(height))
         return;
-      size_t idx = coord_to_idx(p.x, p.y, width);
+      size_t nidx = coord_to_idx(p.x, p.y, width);
       // not empty
-      if (input[idx] == '#')
+      if (input[nidx] == '#')
+        return;
+      float edgeWeight = input[nidx] == 'o' ? 10.f : 1.f;
+      float gScore = g[idx] + 1.f * edgeWeight; // we're exactly 1 unit away
+      if (gScore >= g[nidx])
         return;
-      float edgeWeight = input[idx] == 'o' ? 10.f : 1.f;
-      float gScore = getG(curPos) + 1.f * edgeWeight; // we're exactly 1 unit away
-      if (gScore < getG(p))
+      prev[nidx] = curPos;
+      g[nidx] = gScore;
+      // already expanded with this weight, it waits for the next one
+      if (closedIter[nidx] == iteration)
       {
-        prev[idx] = curPos;
-        g[idx] = gScore;
-        f[idx] = gScore + weight * heuristic(p, to);
+        if (!inconsistent[nidx])
+        {
+          inconsistent[nidx] = true;
+          incons.push_back(uint32_t(nidx));
+        }
       }
-      bool found = std::find(openList.begin(), openList.end(), p) != openList.end();
-      if (!found)
-        openList.emplace_back(p);
+      else
+        openList.push(nidx, key(nidx));
     };
     checkNeighbour({curPos.x + 1, curPos.y + 0});
     checkNeighbour({curPos.x - 1, curPos.y + 0});
     checkNeighbour({curPos.x + 0, curPos.y + 1});
     checkNeighbour({curPos.x + 0, curPos.y - 1});
   }
-  // empty path
-  return std::vector<Position>();
+
+  // moves inconsistent tiles back into the open list and rekeys everything with the new weight
+  void reopen()
+  {
+    while (!openList.empty())
+      incons.push_back(uint32_t(openList.pop()));
+    for (uint32_t idx : incons)
+    {
+      inconsistent[idx] = false;
+      openList.push(idx, key(idx));
+    }
+    incons.clear();
+    iteration++;
+  }
+
+  float min_unweighted_f() const
+  {
+    float res = std::numeric_limits<float>::max();
+    auto f = [&](size_t idx) { return g[idx] + heuristic(Position{int(idx % width), int(idx / width)}, to); };
+    for (uint32_t idx : incons)
+      res = std::min(res, f(idx));
+    for (size_t idx = 0; idx < g.size(); ++idx)
+      if (openList.contains(idx))
+        res = std::min(res, f(idx));
+    return std::min(res, pathCost);
+  }
+
+  const char *input = nullptr;
+  size_t width = 0;
+  size_t height = 0;
+  Position from;
+  Position to;
+  float startWeight = 1.f;
+  float weight = 1.f;
+  float weightStep = 0.5f;
+
+  std::vector<float> g;
+  std::vector<Position> prev;
+  std::vector<uint32_t> closedIter; // expanded during the iteration with this number
+  std::vector<bool> inconsistent;
+  std::vector<uint32_t> incons;
+  IndexedHeap openList;
+  uint32_t iteration = 1;
+
+  std::vector<Position> path;
+  float pathCost = std::numeric_limits<float>::max();
+  float pathBound = std::numeric_limits<float>::max();
+  bool finished = true;
+};
+
+[[maybe_unused]] static void bench_jps(size_t size, size_t num_queries)
+{
+  std::vector<char> tiles(size * size);
+  gen_cellular_dungeon(tiles.data(), size, size, 0.45f, 10);
+  JumpCache jumps(tiles.data(), size, size);
+
+  size_t numFound = 0;
+  size_t numMismatches = 0;
+  double timeMs[2] = {0.0, 0.0};
+  SearchStats stats[2];
+  for (SearchStats &st : stats)
+    st.drawExpanded = false;
+  for (size_t i = 0; i < num_queries; ++i)
+  {
+    const Position from = dungeon::find_walkable_tile(tiles.data(), size, size);
+    const Position to = dungeon::find_walkable_tile(tiles.data(), size, size);
+    std::vector<Position> paths[2];
+    for (size_t mode = 0; mode < 2; ++mode)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      paths[mode] = find_path(tiles.data(), size, size, from, to, 1.f, mode == 1 ? &jumps : nullptr, &stats[mode]);
+      timeMs[mode] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    numFound += !paths[0].empty();
+    numMismatches += paths[0].size() != paths[1].size();
+  }
+  const double queries = double(std::max(num_queries, size_t(1)));
+  printf("jps bench %zux%zu cave, %zu queries, %zu found, %zu path length mismatches\n",
+         size, size, num_queries, numFound, numMismatches);
+  printf("  A*:  %10.1f nodes expanded, %8.3f ms/query\n", double(stats[0].nodesExpanded) / queries, timeMs[0] / queries);
+  printf("  JPS: %10.1f nodes expanded, %8.3f ms/query\n", double(stats[1].nodesExpanded) / queries, timeMs[1] / queries);
 }
 
-void draw_nav_data(const char *input, size_t width, size_t height, Position from, Position to, float weight)
+// LRU cache of found paths. Every entry remembers versions of the regions its path crosses, so making
+// a tile more expensive only drops paths going through its region. A tile getting cheaper can open a
+// shortcut for any path, those whose cost can't be beaten through the tile are kept.
+class PathCache
+{
+public:
+  PathCache(size_t w, size_t h, size_t cap = 64, size_t region_sz = 8)
+    : width(w), height(h), capacity(cap), regionSize(region_sz), regionsX((w + region_sz - 1) / region_sz)
+  {
+    regionVersions.assign(regionsX * ((h + region_sz - 1) / region_sz), 0);
+  }
+
+  void clear()
+  {
+    entries.clear();
+    std::fill(regionVersions.begin(), regionVersions.end(), 0);
+  }
+
+  void on_tile_changed(Position p, char old_tile, char new_tile)
+  {
+    const float oldCost = tile_cost(old_tile);
+    const float newCost = tile_cost(new_tile);
+    if (newCost > oldCost)
+      regionVersions[region_idx(p)]++;
+    else if (newCost < oldCost)
+      entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const Entry &e)
+      {
+        return heuristic(e.from, p) + heuristic(p, e.to) < e.cost / e.weight;
+      }), entries.end());
+  }
+
+  const std::vector<Position> &get_path(const char *input, Position from, Position to, float weight, JumpCache *jumps)
+  {
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+      const Entry &e = entries[i];
+      if (e.from != from || e.to != to || e.weight != weight || e.jps != (jumps != nullptr) || !is_valid(e))
+        continue;
+      // most recently used goes to the front
+      std::rotate(entries.begin(), entries.begin() + ptrdiff_t(i), entries.begin() + ptrdiff_t(i) + 1);
+      return entries.front().path;
+    }
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const Entry &e) { return !is_valid(e); }),
+                  entries.end());
+    if (entries.size() >= capacity)
+      entries.pop_back();
+
+    Entry e{from, to, weight, jumps != nullptr, find_path(input, width, height, from, to, weight, jumps), 0.f, {}};
+    e.cost = e.path.empty() ? std::numeric_limits<float>::max() : 0.f;
+    for (size_t i = 1; i < e.path.size(); ++i)
+      e.cost += tile_cost(input[coord_to_idx(e.path[i].x, e.path[i].y, width)]);
+    for (const Position &p : e.path)
+    {
+      const size_t regIdx = region_idx(p);
+      if (std::find_if(e.regions.begin(), e.regions.end(), [&](const auto &r) { return r.first == regIdx; }) == e.regions.end())
+        e.regions.emplace_back(regIdx, regionVersions[regIdx]);
+    }
+    entries.insert(entries.begin(), std::move(e));
+    return entries.front().path;
+  }
+
+private:
+  struct Entry
+  {
+    Position from;
+    Position to;
+    float weight;
+    bool jps;
+    std::vector<Position> path;
+    float cost = 0.f;
+    std::vector<std::pair<size_t, uint32_t>> regions; // region and its version when the path was found
+  };
+
+  static float tile_cost(char tile) { return tile == '#' ? std::numeric_limits<float>::max() : tile == 'o' ? 10.f : 1.f; }
+
+  size_t region_idx(Position p) const
+  {
+    assert(p.x >= 0 && size_t(p.x) < width && p.y >= 0 && size_t(p.y) < height);
+    return size_t(p.y) / regionSize * regionsX + size_t(p.x) / regionSize;
+  }
+
+  bool is_valid(const Entry &e) const
+  {
+    for (const auto &r : e.regions)
+      if (regionVersions[r.first] != r.second)
+        return false;
+    return true;
+  }
+
+  size_t width;
+  size_t height;
+  size_t capacity;
+  size_t regionSize;
+  size_t regionsX;
+  std::vector<uint32_t> regionVersions;
+  std::vector<Entry> entries; // most recently used first, there are only a few dozens
+};
+
+void draw_nav_data(const char *input, size_t width, size_t height, Position from, Position to, float weight, JumpCache *jumps,
+                   PathCache &path_cache)
 {
   draw_nav_grid(input, width, height);
-  std::vector<Position> path = find_path_a_star(input, width, height, from, to, weight);
+  const std::vector<Position> &path = path_cache.get_path(input, from, to, weight, jumps);
   //std::vector<Position> path = find_ida_star_path(input, width, height, from, to);
   draw_path(path);
 }
@@ -215,6 +825,13 @@ int main(int /*argc*/, const char ** /*argv*/)
   gen_drunk_dungeon(navGrid, dungWidth, dungHeight, 24, 100);
   spill_drunk_water(navGrid, dungWidth, dungHeight, 8, 10);
   float weight = 1.f;
+  bool useJps = false;
+  JumpCache jumps(navGrid, dungWidth, dungHeight);
+  bool useAra = false;
+  constexpr double araBudgetMs = 1.0; // per frame
+  AraStarSearch araSearch;
+  PathCache pathCache(dungWidth, dungHeight);
+  //bench_jps(256, 100);
 
   Position from = dungeon::find_walkable_tile(navGrid, dungWidth, dungHeight);
   Position to = dungeon::find_walkable_tile(navGrid, dungWidth, dungHeight);
@@ -233,7 +850,15 @@ int main(int /*argc*/, const char ** /*argv*/)
     {
       size_t idx = coord_to_idx(p.x, p.y, dungWidth);
       if (idx < dungWidth * dungHeight)
+      {
+        const char oldTile = navGrid[idx];
         navGrid[idx] = navGrid[idx] == ' ' ? '#' : navGrid[idx] == '#' ? 'o' : ' ';
+        // off-map clicks wrap onto some other tile, tell the cache which one
+        const Position tile{int(idx % dungWidth), int(idx / dungWidth)};
+        pathCache.on_tile_changed(tile, oldTile, navGrid[idx]);
+      }
+      jumps.reset();
+      araSearch.invalidate();
     }
     else if (IsMouseButtonPressed(0))
     {
@@ -251,6 +876,20 @@ int main(int /*argc*/, const char ** /*argv*/)
       spill_drunk_water(navGrid, dungWidth, dungHeight, 8, 10);
       from = dungeon::find_walkable_tile(navGrid, dungWidth, dungHeight);
       to = dungeon::find_walkable_tile(navGrid, dungWidth, dungHeight);
+      jumps.reset();
+      araSearch.invalidate();
+      pathCache.clear();
+    }
+    if (IsKeyPressed(KEY_J))
+    {
+      useJps = !useJps;
+      printf("jps %s%s\n", useJps ? "on" : "off",
+             useJps && has_weighted_tiles(navGrid, dungWidth, dungHeight) ? " (water on the map, using A*)" : "");
+    }
+    if (IsKeyPressed(KEY_A))
+    {
+      useAra = !useAra;
+      printf("ara* %s, starts from the current weight\n", useAra ? "on" : "off");
     }
     if (IsKeyPressed(KEY_UP))
     {
@@ -265,7 +904,18 @@ int main(int /*argc*/, const char ** /*argv*/)
     BeginDrawing();
       ClearBackground(BLACK);
       BeginMode2D(camera);
-        draw_nav_data(navGrid, dungWidth, dungHeight, from, to, weight);
+        if (useAra)
+        {
+          if (!araSearch.is_started_for(navGrid, from, to, weight))
+            araSearch.start(navGrid, dungWidth, dungHeight, from, to, weight);
+          if (araSearch.improve(araBudgetMs))
+            printf("ara* path cost %0.1f, at most %0.2f of optimal\n", double(araSearch.get_path_cost()),
+                   double(araSearch.get_path_bound()));
+          draw_nav_grid(navGrid, dungWidth, dungHeight);
+          draw_path(araSearch.get_path());
+        }
+        else
+          draw_nav_data(navGrid, dungWidth, dungHeight, from, to, weight, useJps ? &jumps : nullptr, pathCache);
       EndMode2D();
     EndDrawing();
   }
@@ -18,16 +18,21 @@ StateTransition *create_hitpoints_less_than_transition(float thres);
 StateTransition *create_negate_transition(StateTransition *in);
 StateTransition *create_and_transition(StateTransition *lhs, StateTransition *rhs);
 
-using utility_function = std::function<float(Blackboard&)>;
-
-BehNode *sequence(const std::vector<BehNode*> &nodes);
-BehNode *selector(const std::vector<BehNode*> &nodes);
-BehNode *utility_selector(const std::vector<std::pair<BehNode*, utility_function>> &nodes);
-
-BehNode *move_to_entity(flecs::entity entity, const char *bb_name);
-BehNode *is_low_hp(float thres);
-BehNode *find_enemy(flecs::entity entity, float dist, const char *bb_name);
-BehNode *flee(flecs::entity entity, const char *bb_name);
-BehNode *patrol(flecs::entity entity, float patrol_dist, const char *bb_name);
-BehNode *patch_up(float thres);
+// behaviour tree nodes, compile the root with compile_beh_tree
+// sequence and selector resume from their running child,
+// reactive ones re-check every child from the first and abort the running branch if another takes over
+BehNodeDesc sequence(std::vector<BehNodeDesc> nodes);
+BehNodeDesc selector(std::vector<BehNodeDesc> nodes);
+BehNodeDesc reactive_sequence(std::vector<BehNodeDesc> nodes);
+BehNodeDesc reactive_selector(std::vector<BehNodeDesc> nodes);
+BehNodeDesc utility_selector(std::vector<std::pair<BehNodeDesc, UtilityDesc>> nodes);
 
+BehNodeDesc move_to_entity(const char *bb_name);
+BehNodeDesc is_low_hp(float thres);
+BehNodeDesc find_enemy(float dist, const char *bb_name);
+BehNodeDesc flee(const char *bb_name);
+BehNodeDesc patrol(float patrol_dist, const char *bb_name);
+BehNodeDesc patch_up(float thres);
+// stops ticking the tree for a number of turns, an enemy within wake_radius
+// or a change of the float var wake_bb_name (may be null) wakes it earlier
+BehNodeDesc sleep_for(float turns, float wake_radius, const char *wake_bb_name);
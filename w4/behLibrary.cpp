@@ -5,298 +5,470 @@
 #include "raylib.h"
 #include "blackboard.h"
 #include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cassert>
 
-struct CompoundNode : public BehNode
+static BehResult move_to_entity_update(flecs::entity entity, Blackboard &bb, size_t entityBb)
 {
-  std::vector<BehNode*> nodes;
-
-  virtual ~CompoundNode()
-  {
-    for (BehNode *node : nodes)
-      delete node;
-    nodes.clear();
-  }
-
-  CompoundNode &pushNode(BehNode *node)
+  BehResult res = BEH_RUNNING;
+  entity.insert([&](Action &a, const Position &pos)
   {
-    nodes.push_back(node);
-    return *this;
-  }
-};
+    flecs::entity targetEntity = bb.get<flecs::entity>(entityBb);
+    if (!targetEntity.is_alive())
+    {
+      res = BEH_FAIL;
+      return;
+    }
+    targetEntity.get([&](const Position &target_pos)
+    {
+      if (pos != target_pos)
+      {
+        a.action = move_towards(pos, target_pos);
+        res = BEH_RUNNING;
+      }
+      else
+        res = BEH_SUCCESS;
+    });
+  });
+  return res;
+}
 
-struct Sequence : public CompoundNode
+static BehResult is_low_hp_update(flecs::entity entity, float threshold)
 {
-  BehResult update(flecs::world &ecs, flecs::entity entity, Blackboard &bb) override
+  BehResult res = BEH_SUCCESS;
+  entity.get([&](const Hitpoints &hp)
   {
-    for (BehNode *node : nodes)
-    {
-      BehResult res = node->update(ecs, entity, bb);
-      if (res != BEH_SUCCESS)
-        return res;
-    }
-    return BEH_SUCCESS;
-  }
-};
+    res = hp.hitpoints < threshold ? BEH_SUCCESS : BEH_FAIL;
+  });
+  return res;
+}
 
-struct Selector : public CompoundNode
+static BehResult find_enemy_update(flecs::world &ecs, flecs::entity entity, Blackboard &bb, size_t entityBb,
+                                   float distance)
 {
-  BehResult update(flecs::world &ecs, flecs::entity entity, Blackboard &bb) override
+  BehResult res = BEH_FAIL;
+  static auto enemiesQuery = ecs.query<const Position, const Team>();
+  entity.insert([&](const Position &pos, const Team &t)
   {
-    for (BehNode *node : nodes)
+    flecs::entity closestEnemy;
+    float closestDist = FLT_MAX;
+    Position closestPos;
+    enemiesQuery.each([&](flecs::entity enemy, const Position &epos, const Team &et)
     {
-      BehResult res = node->update(ecs, entity, bb);
-      if (res != BEH_FAIL)
-        return res;
+      if (t.team == et.team)
+        return;
+      float curDist = dist(epos, pos);
+      if (curDist < closestDist)
+      {
+        closestDist = curDist;
+        closestPos = epos;
+        closestEnemy = enemy;
+      }
+    });
+    if (ecs.is_valid(closestEnemy) && closestDist <= distance)
+    {
+      bb.set<flecs::entity>(entityBb, closestEnemy);
+      res = BEH_SUCCESS;
     }
-    return BEH_FAIL;
-  }
-};
+  });
+  return res;
+}
 
-struct UtilitySelector : public BehNode
+static BehResult flee_update(flecs::entity entity, Blackboard &bb, size_t entityBb)
 {
-  std::vector<std::pair<BehNode*, utility_function>> utilityNodes;
-
-  BehResult update(flecs::world &ecs, flecs::entity entity, Blackboard &bb) override
+  BehResult res = BEH_RUNNING;
+  entity.insert([&](Action &a, const Position &pos)
   {
-    std::vector<std::pair<float, size_t>> utilityScores;
-    for (size_t i = 0; i < utilityNodes.size(); ++i)
+    flecs::entity targetEntity = bb.get<flecs::entity>(entityBb);
+    if (!targetEntity.is_alive())
     {
-      const float utilityScore = utilityNodes[i].second(bb);
-      utilityScores.push_back(std::make_pair(utilityScore, i));
+      res = BEH_FAIL;
+      return;
     }
-    std::sort(utilityScores.begin(), utilityScores.end(), [](auto &lhs, auto &rhs)
+    targetEntity.get([&](const Position &target_pos)
     {
-      return lhs.first > rhs.first;
+      a.action = inverse_move(move_towards(pos, target_pos));
     });
-    for (const std::pair<float, size_t> &node : utilityScores)
-    {
-      size_t nodeIdx = node.second;
-      BehResult res = utilityNodes[nodeIdx].first->update(ecs, entity, bb);
-      if (res != BEH_FAIL)
-        return res;
-    }
-    return BEH_FAIL;
-  }
-};
+  });
+  return res;
+}
 
-struct MoveToEntity : public BehNode
+static BehResult patrol_update(flecs::entity entity, Blackboard &bb, size_t pposBb, float patrolDist)
 {
-  size_t entityBb = size_t(-1); // wraps to 0xff...
-  MoveToEntity(flecs::entity entity, const char *bb_name)
+  BehResult res = BEH_RUNNING;
+  entity.insert([&](Action &a, const Position &pos)
   {
-    entityBb = reg_entity_blackboard_var<flecs::entity>(entity, bb_name);
-  }
+    Position patrolPos = bb.get<Position>(pposBb);
+    if (dist(pos, patrolPos) > patrolDist)
+      a.action = move_towards(pos, patrolPos);
+    else
+      a.action = GetRandomValue(EA_MOVE_START, EA_MOVE_END - 1); // do a random walk
+  });
+  return res;
+}
 
-  BehResult update(flecs::world &, flecs::entity entity, Blackboard &bb) override
+static BehResult patch_up_update(flecs::entity entity, float hpThreshold)
+{
+  BehResult res = BEH_SUCCESS;
+  entity.insert([&](Action &a, Hitpoints &hp)
   {
-    BehResult res = BEH_RUNNING;
-    entity.insert([&](Action &a, const Position &pos)
-    {
-      flecs::entity targetEntity = bb.get<flecs::entity>(entityBb);
-      if (!targetEntity.is_alive())
-      {
-        res = BEH_FAIL;
-        return;
-      }
-      targetEntity.get([&](const Position &target_pos)
-      {
-        if (pos != target_pos)
-        {
-          a.action = move_towards(pos, target_pos);
-          res = BEH_RUNNING;
-        }
-        else
-          res = BEH_SUCCESS;
-      });
-    });
-    return res;
-  }
+    if (hp.hitpoints >= hpThreshold)
+      return;
+    res = BEH_RUNNING;
+    a.action = EA_HEAL_SELF;
+  });
+  return res;
+}
+
+struct BehContext
+{
+  flecs::world &ecs;
+  flecs::entity entity;
+  Blackboard &bb;
+  const BehTreeDef &def;
+  const uint16_t *bbIndices;
+  uint16_t *runningChild;
+  BehaviourTree::Sleep &sleep;
+  const float *utilityScores;
+  size_t utilityStride;
 };
 
-struct IsLowHp : public BehNode
+static BehResult update_node(const BehContext &ctx, uint32_t idx);
+
+// drops whatever the branch was in the middle of, it starts from scratch next time
+static void reset_subtree(const BehContext &ctx, uint32_t idx)
 {
-  float threshold = 0.f;
-  IsLowHp(float thres) : threshold(thres) {}
+  std::fill_n(ctx.runningChild + idx, ctx.def.nodes[idx].subtreeSize, uint16_t(0));
+}
+
+// remembers which child ended up running and aborts the one that was running before if it differs
+static void set_running_child(const BehContext &ctx, uint32_t idx, uint32_t child, BehResult res)
+{
+  uint16_t &running = ctx.runningChild[idx];
+  if (running && idx + running != child)
+    reset_subtree(ctx, idx + running);
+  running = res == BEH_RUNNING ? uint16_t(child - idx) : 0;
+}
 
-  BehResult update(flecs::world &, flecs::entity entity, Blackboard &) override
+// sequence stops on anything but success, selector on anything but fail.
+// Regular composites resume from the running child, reactive ones start from the first child every tick.
+static BehResult update_composite(const BehContext &ctx, uint32_t idx, BehResult continue_on, bool reactive)
+{
+  const uint32_t running = ctx.runningChild[idx];
+  const uint32_t end = idx + ctx.def.nodes[idx].subtreeSize;
+  uint32_t child = !reactive && running ? idx + running : idx + 1;
+  BehResult res = continue_on;
+  for (; child < end; child += ctx.def.nodes[child].subtreeSize)
   {
-    BehResult res = BEH_SUCCESS;
-    entity.get([&](const Hitpoints &hp)
-    {
-      res = hp.hitpoints < threshold ? BEH_SUCCESS : BEH_FAIL;
-    });
-    return res;
+    res = update_node(ctx, child);
+    if (res != continue_on)
+      break;
   }
-};
+  set_running_child(ctx, idx, child, res);
+  return res;
+}
 
-struct FindEnemy : public BehNode
+// children are tried from the best score down, picking the next best only if the previous one failed
+static BehResult update_utility_selector(const BehContext &ctx, uint32_t idx)
 {
-  size_t entityBb = size_t(-1);
-  float distance = 0;
-  FindEnemy(flecs::entity entity, float in_dist, const char *bb_name) : distance(in_dist)
+  const BehTreeDef::Node &node = ctx.def.nodes[idx];
+  float scores[BehTreeDef::maxUtilityChildren];
+  uint32_t children[BehTreeDef::maxUtilityChildren];
+  const uint32_t count = node.numChildren;
+  for (uint32_t i = 0, child = idx + 1; i < count; ++i, child += ctx.def.nodes[child].subtreeSize)
   {
-    entityBb = reg_entity_blackboard_var<flecs::entity>(entity, bb_name);
+    scores[i] = ctx.utilityScores[(node.firstUtility + i) * ctx.utilityStride];
+    children[i] = child;
   }
-  BehResult update(flecs::world &ecs, flecs::entity entity, Blackboard &bb) override
+  for (uint32_t i = 0; i < count; ++i)
   {
-    BehResult res = BEH_FAIL;
-    static auto enemiesQuery = ecs.query<const Position, const Team>();
-    entity.insert([&](const Position &pos, const Team &t)
+    uint32_t best = i;
+    for (uint32_t j = i + 1; j < count; ++j)
+      if (scores[j] > scores[best])
+        best = j;
+    std::swap(scores[i], scores[best]);
+    std::swap(children[i], children[best]);
+    BehResult res = update_node(ctx, children[i]);
+    if (res != BEH_FAIL)
     {
-      flecs::entity closestEnemy;
-      float closestDist = FLT_MAX;
-      Position closestPos;
-      enemiesQuery.each([&](flecs::entity enemy, const Position &epos, const Team &et)
-      {
-        if (t.team == et.team)
-          return;
-        float curDist = dist(epos, pos);
-        if (curDist < closestDist)
-        {
-          closestDist = curDist;
-          closestPos = epos;
-          closestEnemy = enemy;
-        }
-      });
-      if (ecs.is_valid(closestEnemy) && closestDist <= distance)
-      {
-        bb.set<flecs::entity>(entityBb, closestEnemy);
-        res = BEH_SUCCESS;
-      }
-    });
-    return res;
+      set_running_child(ctx, idx, children[i], res);
+      return res;
+    }
   }
-};
+  set_running_child(ctx, idx, idx + node.subtreeSize, BEH_FAIL);
+  return BEH_FAIL;
+}
 
-struct Flee : public BehNode
+// puts the tree to sleep and succeeds once it's woken up
+static BehResult sleep_update(const BehContext &ctx, uint32_t idx, size_t watchedBb)
 {
-  size_t entityBb = size_t(-1);
-  Flee(flecs::entity entity, const char *bb_name)
+  const BehTreeDef::Node &node = ctx.def.nodes[idx];
+  uint16_t &slept = ctx.runningChild[idx]; // leaves don't have children, so the slot marks that we've slept
+  if (slept)
   {
-    entityBb = reg_entity_blackboard_var<flecs::entity>(entity, bb_name);
+    slept = 0;
+    return BEH_SUCCESS;
   }
+  slept = 1;
+  ctx.sleep.asleep = true;
+  ctx.sleep.turnsLeft = int(node.param);
+  ctx.sleep.wakeRadius = node.param2;
+  ctx.sleep.watchedBb = watchedBb;
+  ctx.sleep.watchedValue = watchedBb != size_t(-1) ? ctx.bb.get<float>(watchedBb) : 0.f;
+  return BEH_RUNNING;
+}
 
-  BehResult update(flecs::world &, flecs::entity entity, Blackboard &bb) override
+static BehResult update_node(const BehContext &ctx, uint32_t idx)
+{
+  const BehTreeDef::Node &node = ctx.def.nodes[idx];
+  const size_t bbIdx = node.bbSlot != 0xffff ? ctx.bbIndices[node.bbSlot] : size_t(-1);
+  switch (node.type)
   {
-    BehResult res = BEH_RUNNING;
-    entity.insert([&](Action &a, const Position &pos)
-    {
-      flecs::entity targetEntity = bb.get<flecs::entity>(entityBb);
-      if (!targetEntity.is_alive())
-      {
-        res = BEH_FAIL;
-        return;
-      }
-      targetEntity.get([&](const Position &target_pos)
-      {
-        a.action = inverse_move(move_towards(pos, target_pos));
-      });
-    });
-    return res;
+    case BEH_SEQUENCE:
+      return update_composite(ctx, idx, BEH_SUCCESS, false);
+    case BEH_SELECTOR:
+      return update_composite(ctx, idx, BEH_FAIL, false);
+    case BEH_REACTIVE_SEQUENCE:
+      return update_composite(ctx, idx, BEH_SUCCESS, true);
+    case BEH_REACTIVE_SELECTOR:
+      return update_composite(ctx, idx, BEH_FAIL, true);
+    case BEH_UTILITY_SELECTOR:
+      return update_utility_selector(ctx, idx);
+    case BEH_MOVE_TO_ENTITY:
+      return move_to_entity_update(ctx.entity, ctx.bb, bbIdx);
+    case BEH_IS_LOW_HP:
+      return is_low_hp_update(ctx.entity, node.param);
+    case BEH_FIND_ENEMY:
+      return find_enemy_update(ctx.ecs, ctx.entity, ctx.bb, bbIdx, node.param);
+    case BEH_FLEE:
+      return flee_update(ctx.entity, ctx.bb, bbIdx);
+    case BEH_PATROL:
+      return patrol_update(ctx.entity, ctx.bb, bbIdx, node.param);
+    case BEH_PATCH_UP:
+      return patch_up_update(ctx.entity, node.param);
+    case BEH_SLEEP:
+      return sleep_update(ctx, idx, bbIdx);
   }
-};
+  return BEH_FAIL;
+}
+
+// gathers the inputs into columns and runs every curve over all agents at once,
+// scores end up as one row per utility with a column per agent
+static void eval_utilities(const BehTreeDef &def, std::span<const BehAgent> agents,
+                           std::vector<float> &inputs, std::vector<float> &scores)
+{
+  const size_t count = agents.size();
+  inputs.resize(def.curveInputs.size() * count);
+  for (size_t col = 0; col < def.curveInputs.size(); ++col)
+    for (size_t i = 0; i < count; ++i)
+      inputs[col * count + i] = agents[i].bb->get<float>(agents[i].bt->inputBbIndices[col]);
+  scores.resize(def.utilityBias.size() * count);
+  for (size_t u = 0; u < def.utilityBias.size(); ++u)
+    std::fill_n(scores.data() + u * count, count, def.utilityBias[u]);
+  for (const CompiledCurve &curve : def.curves)
+    eval_curve(curve, inputs.data() + curve.column * count, scores.data() + curve.utility * count, count);
+}
+
+void BehaviourTree::update(flecs::world &ecs, flecs::entity entity, Blackboard &bb,
+                           const float *utility_scores, size_t stride)
+{
+  if (!def || def->nodes.empty())
+    return;
+  sleep.asleep = false;
+  update_node(BehContext{ecs, entity, bb, *def, bbIndices.data(), runningChild.data(), sleep,
+                         utility_scores, stride}, 0);
+}
 
-struct Patrol : public BehNode
+void update_beh_trees(flecs::world &ecs, std::span<const BehAgent> agents)
 {
-  size_t pposBb = size_t(-1);
-  float patrolDist = 1.f;
-  Patrol(flecs::entity entity, float patrol_dist, const char *bb_name)
-    : patrolDist(patrol_dist)
+  static std::vector<float> inputs;
+  static std::vector<float> scores;
+  for (size_t from = 0; from < agents.size();)
   {
-    pposBb = reg_entity_blackboard_var<Position>(entity, bb_name);
-    entity.insert([&](Blackboard &bb, const Position &pos)
+    const BehTreeDef *def = agents[from].bt->def.get();
+    size_t to = from + 1;
+    while (to < agents.size() && agents[to].bt->def.get() == def)
+      ++to;
+    const size_t count = to - from;
+    if (def)
+      eval_utilities(*def, agents.subspan(from, count), inputs, scores);
+    for (size_t i = 0; i < count; ++i)
     {
-      bb.set<Position>(pposBb, pos);
-    });
+      const BehAgent &agent = agents[from + i];
+      agent.bt->update(ecs, agent.entity, *agent.bb, scores.data() + i, count);
+    }
+    from = to;
   }
+}
 
-  BehResult update(flecs::world &, flecs::entity entity, Blackboard &bb) override
+bool BehaviourTree::wake_up(const Blackboard &bb, float closest_enemy_dist)
+{
+  if (sleep.turnsLeft-- > 0 &&
+      closest_enemy_dist > sleep.wakeRadius &&
+      (sleep.watchedBb == size_t(-1) || bb.get<float>(sleep.watchedBb) == sleep.watchedValue))
+    return false;
+  sleep.asleep = false;
+  return true;
+}
+
+static void flatten_node(const BehNodeDesc &desc, BehTreeDef &def)
+{
+  const size_t idx = def.nodes.size();
+  BehTreeDef::Node node;
+  node.type = desc.type;
+  node.param = desc.param;
+  node.param2 = desc.param2;
+  size_t numChildren = desc.children.size();
+  if (desc.type == BEH_UTILITY_SELECTOR)
   {
-    BehResult res = BEH_RUNNING;
-    entity.insert([&](Action &a, const Position &pos)
+    const size_t fit = std::min(std::min(desc.children.size(), desc.utilities.size()), BehTreeDef::maxUtilityChildren);
+    if (fit != desc.children.size() || fit != desc.utilities.size())
     {
-      Position patrolPos = bb.get<Position>(pposBb);
-      if (dist(pos, patrolPos) > patrolDist)
-        a.action = move_towards(pos, patrolPos);
-      else
-        a.action = GetRandomValue(EA_MOVE_START, EA_MOVE_END - 1); // do a random walk
-    });
-    return res;
+      fprintf(stderr, "beh: utility selector with %zu children and %zu utilities, only %zu fit\n",
+              desc.children.size(), desc.utilities.size(), fit);
+      assert(false);
+    }
+    numChildren = fit;
   }
-};
+  node.numChildren = uint16_t(numChildren);
+  if (desc.bbName)
+  {
+    node.bbSlot = uint16_t(def.bbNames.size());
+    def.bbNames.push_back(desc.bbName);
+  }
+  if (desc.type == BEH_UTILITY_SELECTOR)
+  {
+    node.firstUtility = uint32_t(def.utilityBias.size());
+    for (size_t i = 0; i < numChildren; ++i)
+    {
+      const UtilityDesc &utility = desc.utilities[i];
+      const uint16_t row = uint16_t(def.utilityBias.size());
+      def.utilityBias.push_back(utility.bias);
+      for (const UtilityCurve &curve : utility.curves)
+      {
+        // curves reading the same var share its column
+        auto itf = std::find_if(def.curveInputs.begin(), def.curveInputs.end(),
+                                [&](const char *name) { return strcmp(name, curve.input) == 0; });
+        const uint16_t column = uint16_t(itf - def.curveInputs.begin());
+        if (itf == def.curveInputs.end())
+          def.curveInputs.push_back(curve.input);
+        def.curves.push_back(compile_curve(curve, column, row));
+      }
+    }
+  }
+  def.nodes.push_back(node);
+  for (size_t i = 0; i < numChildren; ++i)
+    flatten_node(desc.children[i], def);
+  def.nodes[idx].subtreeSize = uint32_t(def.nodes.size() - idx);
+}
 
-struct PatchUp : public BehNode
+std::shared_ptr<const BehTreeDef> compile_beh_tree(const BehNodeDesc &root)
 {
-  float hpThreshold = 100.f;
-  PatchUp(float threshold) : hpThreshold(threshold) {}
+  std::shared_ptr<BehTreeDef> def = std::make_shared<BehTreeDef>();
+  flatten_node(root, *def);
+  return def;
+}
 
-  BehResult update(flecs::world &, flecs::entity entity, Blackboard &) override
+void create_beh_tree(flecs::entity entity, std::shared_ptr<const BehTreeDef> def)
+{
+  BehaviourTree bt;
+  bt.bbIndices.resize(def->bbNames.size());
+  bt.runningChild.resize(def->nodes.size(), 0);
+  for (const char *input : def->curveInputs)
+    bt.inputBbIndices.push_back(uint16_t(reg_entity_blackboard_var<float>(entity, input)));
+  for (const BehTreeDef::Node &node : def->nodes)
   {
-    BehResult res = BEH_SUCCESS;
-    entity.insert([&](Action &a, Hitpoints &hp)
+    if (node.bbSlot == 0xffff)
+      continue;
+    const char *bbName = def->bbNames[node.bbSlot];
+    size_t bbIdx = size_t(-1);
+    switch (node.type)
     {
-      if (hp.hitpoints >= hpThreshold)
-        return;
-      res = BEH_RUNNING;
-      a.action = EA_HEAL_SELF;
-    });
-    return res;
+      case BEH_PATROL:
+        bbIdx = reg_entity_blackboard_var<Position>(entity, bbName);
+        entity.insert([&](Blackboard &bb, const Position &pos)
+        {
+          bb.set<Position>(bbIdx, pos);
+        });
+        break;
+      case BEH_SLEEP:
+        bbIdx = reg_entity_blackboard_var<float>(entity, bbName);
+        break;
+      default:
+        bbIdx = reg_entity_blackboard_var<flecs::entity>(entity, bbName);
+        break;
+    }
+    bt.bbIndices[node.bbSlot] = uint16_t(bbIdx);
   }
-};
+  bt.def = std::move(def);
+  entity.set(std::move(bt));
+}
 
 
+BehNodeDesc sequence(std::vector<BehNodeDesc> nodes)
+{
+  return BehNodeDesc{BEH_SEQUENCE, 0.f, nullptr, std::move(nodes), {}};
+}
 
-BehNode *sequence(const std::vector<BehNode*> &nodes)
+BehNodeDesc selector(std::vector<BehNodeDesc> nodes)
 {
-  Sequence *seq = new Sequence;
-  for (BehNode *node : nodes)
-    seq->pushNode(node);
-  return seq;
+  return BehNodeDesc{BEH_SELECTOR, 0.f, nullptr, std::move(nodes), {}};
 }
 
-BehNode *selector(const std::vector<BehNode*> &nodes)
+BehNodeDesc reactive_sequence(std::vector<BehNodeDesc> nodes)
 {
-  Selector *sel = new Selector;
-  for (BehNode *node : nodes)
-    sel->pushNode(node);
-  return sel;
+  return BehNodeDesc{BEH_REACTIVE_SEQUENCE, 0.f, nullptr, std::move(nodes), {}};
 }
 
-BehNode *utility_selector(const std::vector<std::pair<BehNode*, utility_function>> &nodes)
+BehNodeDesc reactive_selector(std::vector<BehNodeDesc> nodes)
 {
-  UtilitySelector *usel = new UtilitySelector;
-  usel->utilityNodes = std::move(nodes);
+  return BehNodeDesc{BEH_REACTIVE_SELECTOR, 0.f, nullptr, std::move(nodes), {}};
+}
+
+BehNodeDesc utility_selector(std::vector<std::pair<BehNodeDesc, UtilityDesc>> nodes)
+{
+  BehNodeDesc usel{BEH_UTILITY_SELECTOR, 0.f, nullptr, {}, {}};
+  for (std::pair<BehNodeDesc, UtilityDesc> &node : nodes)
+  {
+    usel.children.push_back(std::move(node.first));
+    usel.utilities.push_back(std::move(node.second));
+  }
   return usel;
 }
 
-BehNode *move_to_entity(flecs::entity entity, const char *bb_name)
+BehNodeDesc move_to_entity(const char *bb_name)
 {
-  return new MoveToEntity(entity, bb_name);
+  return BehNodeDesc{BEH_MOVE_TO_ENTITY, 0.f, bb_name, {}, {}};
 }
 
-BehNode *is_low_hp(float thres)
+BehNodeDesc is_low_hp(float thres)
 {
-  return new IsLowHp(thres);
+  return BehNodeDesc{BEH_IS_LOW_HP, thres, nullptr, {}, {}};
 }
 
-BehNode *find_enemy(flecs::entity entity, float dist, const char *bb_name)
+BehNodeDesc find_enemy(float dist, const char *bb_name)
 {
-  return new FindEnemy(entity, dist, bb_name);
+  return BehNodeDesc{BEH_FIND_ENEMY, dist, bb_name, {}, {}};
 }
 
-BehNode *flee(flecs::entity entity, const char *bb_name)
+BehNodeDesc flee(const char *bb_name)
 {
-  return new Flee(entity, bb_name);
+  return BehNodeDesc{BEH_FLEE, 0.f, bb_name, {}, {}};
 }
 
-BehNode *patrol(flecs::entity entity, float patrol_dist, const char *bb_name)
+BehNodeDesc patrol(float patrol_dist, const char *bb_name)
 {
-  return new Patrol(entity, patrol_dist, bb_name);
+  return BehNodeDesc{BEH_PATROL, patrol_dist, bb_name, {}, {}};
 }
 
-BehNode *patch_up(float thres)
+BehNodeDesc patch_up(float thres)
 {
-  return new PatchUp(thres);
+  return BehNodeDesc{BEH_PATCH_UP, thres, nullptr, {}, {}};
 }
 
+BehNodeDesc sleep_for(float turns, float wake_radius, const char *wake_bb_name)
+{
+  return BehNodeDesc{BEH_SLEEP, turns, wake_bb_name, {}, {}, wake_radius};
+}
 
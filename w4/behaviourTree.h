@@ -2,7 +2,11 @@
 
 #include <flecs.h>
 #include <memory>
+#include <vector>
+#include <span>
+#include <cstdint>
 #include "blackboard.h"
+#include "utilityCurves.h"
 
 enum BehResult
 {
@@ -11,30 +15,92 @@ enum BehResult
   BEH_RUNNING
 };
 
-struct BehNode
+enum BehNodeType : uint8_t
 {
-  virtual ~BehNode() {}
-  virtual BehResult update(flecs::world &ecs, flecs::entity entity, Blackboard &bb) = 0;
+  BEH_SEQUENCE,
+  BEH_SELECTOR,
+  BEH_REACTIVE_SEQUENCE,
+  BEH_REACTIVE_SELECTOR,
+  BEH_UTILITY_SELECTOR,
+  BEH_MOVE_TO_ENTITY,
+  BEH_IS_LOW_HP,
+  BEH_FIND_ENEMY,
+  BEH_FLEE,
+  BEH_PATROL,
+  BEH_PATCH_UP,
+  BEH_SLEEP
 };
 
-struct BehaviourTree
+// tree as it's written in code, gets compiled into a BehTreeDef
+struct BehNodeDesc
 {
-  std::unique_ptr<BehNode> root = nullptr;
-
-  BehaviourTree() = default;
-  BehaviourTree(BehNode *r) : root(r) {}
+  BehNodeType type;
+  float param = 0.f;
+  const char *bbName = nullptr;
+  std::vector<BehNodeDesc> children;
+  std::vector<UtilityDesc> utilities; // one per child for utility selectors, at most 16
+  float param2 = 0.f;
+};
 
-  BehaviourTree(const BehaviourTree &bt) = delete;
-  BehaviourTree(BehaviourTree &&bt) = default;
+// Nodes flattened in depth first order into one array, shared by every entity running the tree.
+// Anything per entity lives in BehaviourTree.
+struct BehTreeDef
+{
+  static constexpr size_t maxUtilityChildren = 16;
 
-  BehaviourTree &operator=(const BehaviourTree &bt) = delete;
-  BehaviourTree &operator=(BehaviourTree &&bt) = default;
+  struct Node
+  {
+    BehNodeType type;
+    uint16_t numChildren = 0;
+    uint16_t bbSlot = 0xffff; // index into BehaviourTree::bbIndices
+    uint32_t subtreeSize = 1; // the node itself and everything under it, next sibling is this far away
+    uint32_t firstUtility = 0; // utilities of the children for utility selectors
+    float param = 0.f;
+    float param2 = 0.f;
+  };
+  std::vector<Node> nodes;
+  std::vector<const char *> bbNames; // per slot
+  // utilities are scored for all agents sharing the def at once, as a matrix of utility rows by agent columns
+  std::vector<float> utilityBias; // per utility
+  std::vector<CompiledCurve> curves;
+  std::vector<const char *> curveInputs; // float blackboard vars the curves read, one column each
+};
 
-  ~BehaviourTree() = default;
+struct BehaviourTree
+{
+  std::shared_ptr<const BehTreeDef> def;
+  std::vector<uint16_t> bbIndices; // blackboard indices of the def's slots for this entity
+  // per node, offset of the child that was running last tick (0 if none)
+  std::vector<uint16_t> runningChild;
 
-  void update(flecs::world &ecs, flecs::entity entity, Blackboard &bb)
+  // set by a sleep node, the tree isn't ticked until one of the conditions fires
+  struct Sleep
   {
-    root->update(ecs, entity, bb);
-  }
+    bool asleep = false;
+    int turnsLeft = 0;
+    float wakeRadius = 0.f; // wake if an enemy gets this close, 0 to ignore
+    size_t watchedBb = size_t(-1); // wake if this float blackboard var changes
+    float watchedValue = 0.f;
+  };
+  Sleep sleep;
+
+  std::vector<uint16_t> inputBbIndices; // blackboard indices of the def's curve inputs
+
+  // score of utility i is utility_scores[i * stride], see update_beh_trees
+  void update(flecs::world &ecs, flecs::entity entity, Blackboard &bb, const float *utility_scores, size_t stride);
+  // called once a turn while asleep, returns true if the tree should be ticked this turn
+  bool wake_up(const Blackboard &bb, float closest_enemy_dist);
 };
 
+std::shared_ptr<const BehTreeDef> compile_beh_tree(const BehNodeDesc &root);
+// registers blackboard vars of the tree for the entity and sets BehaviourTree on it
+void create_beh_tree(flecs::entity entity, std::shared_ptr<const BehTreeDef> def);
+
+struct BehAgent
+{
+  flecs::entity entity;
+  BehaviourTree *bt;
+  Blackboard *bb;
+};
+// ticks the agents, those with the same def should be next to each other so their utilities are scored together
+void update_beh_trees(flecs::world &ecs, std::span<const BehAgent> agents);
@@ -1,6 +1,7 @@
 #include "dijkstraMapGen.h"
 #include "ecsTypes.h"
 #include "dungeonUtils.h"
+#include "dmapSolver.h"
 
 template<typename Callable>
 static void query_dungeon_data(flecs::world &ecs, Callable c)
@@ -18,52 +19,16 @@ static void query_characters_positions(flecs::world &ecs, Callable c)
   characterPositionQuery.each(c);
 }
 
-constexpr float invalid_tile_value = 1e5f;
-
 static void init_tiles(std::vector<float> &map, const DungeonData &dd)
 {
   map.resize(dd.width * dd.height);
   for (float &v : map)
-    v = invalid_tile_value;
+    v = dmaps::invalid_tile_value;
 }
 
-// scan version, could be implemented as Dijkstra version as well
 static void process_dmap(std::vector<float> &map, const DungeonData &dd)
 {
-  bool done = false;
-  auto getMapAt = [&](size_t x, size_t y, float def)
-  {
-    if (x < dd.width && y < dd.width && dd.tiles[y * dd.width + x] == dungeon::floor)
-      return map[y * dd.width + x];
-    return def;
-  };
-  auto getMinNei = [&](size_t x, size_t y)
-  {
-    float val = map[y * dd.width + x];
-    val = std::min(val, getMapAt(x - 1, y + 0, val));
-    val = std::min(val, getMapAt(x + 1, y + 0, val));
-    val = std::min(val, getMapAt(x + 0, y - 1, val));
-    val = std::min(val, getMapAt(x + 0, y + 1, val));
-    return val;
-  };
-  while (!done)
-  {
-    done = true;
-    for (size_t y = 0; y < dd.height; ++y)
-      for (size_t x = 0; x < dd.width; ++x)
-      {
-        const size_t i = y * dd.width + x;
-        if (dd.tiles[i] != dungeon::floor)
-          continue;
-        const float myVal = getMapAt(x, y, invalid_tile_value);
-        const float minVal = getMinNei(x, y);
-        if (minVal < myVal - 1.f)
-        {
-          map[i] = minVal + 1.f;
-          done = false;
-        }
-      }
-  }
+  dmaps::process_dmap_wavefront(map, dd);
 }
 
 void dmaps::gen_player_approach_map(flecs::world &ecs, std::vector<float> &map)
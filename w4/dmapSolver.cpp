@@ -0,0 +1,98 @@
+#include "dmapSolver.h"
+#include "dungeonUtils.h"
+#include <algorithm>
+#include <cstdint>
+
+void dmaps::process_dmap_scan(std::vector<float> &map, const DungeonData &dd)
+{
+  bool done = false;
+  auto getMapAt = [&](size_t x, size_t y, float def)
+  {
+    if (x < dd.width && y < dd.width && dd.tiles[y * dd.width + x] == dungeon::floor)
+      return map[y * dd.width + x];
+    return def;
+  };
+  auto getMinNei = [&](size_t x, size_t y)
+  {
+    float val = map[y * dd.width + x];
+    val = std::min(val, getMapAt(x - 1, y + 0, val));
+    val = std::min(val, getMapAt(x + 1, y + 0, val));
+    val = std::min(val, getMapAt(x + 0, y - 1, val));
+    val = std::min(val, getMapAt(x + 0, y + 1, val));
+    return val;
+  };
+  while (!done)
+  {
+    done = true;
+    for (size_t y = 0; y < dd.height; ++y)
+      for (size_t x = 0; x < dd.width; ++x)
+      {
+        const size_t i = y * dd.width + x;
+        if (dd.tiles[i] != dungeon::floor)
+          continue;
+        const float myVal = getMapAt(x, y, invalid_tile_value);
+        const float minVal = getMinNei(x, y);
+        if (minVal < myVal - 1.f)
+        {
+          map[i] = minVal + 1.f;
+          done = false;
+        }
+      }
+  }
+}
+
+// All edges cost exactly 1, so popped values never decrease and every value pushed
+// to the wave is (last popped + 1). That makes the wave a sorted FIFO, and merging it
+// with the sorted seed list gives an exact priority queue without a heap.
+// Every floor tile is popped at most once.
+void dmaps::process_dmap_wavefront(std::vector<float> &map, const DungeonData &dd)
+{
+  std::vector<std::pair<float, size_t>> seeds;
+  for (size_t i = 0; i < map.size(); ++i)
+    if (dd.tiles[i] == dungeon::floor && map[i] < invalid_tile_value)
+      seeds.emplace_back(map[i], i);
+  // approach-like maps have all seeds at 0, only flee maps really need sorting
+  std::stable_sort(seeds.begin(), seeds.end(), [](const auto &lhs, const auto &rhs)
+  {
+    return lhs.first < rhs.first;
+  });
+
+  std::vector<uint8_t> settled(map.size(), 0);
+  std::vector<size_t> wave;
+  wave.reserve(map.size());
+  size_t waveHead = 0;
+  size_t seedHead = 0;
+
+  auto relax = [&](size_t idx, float val)
+  {
+    if (dd.tiles[idx] != dungeon::floor || settled[idx] || !(val < map[idx]))
+      return;
+    map[idx] = val;
+    wave.push_back(idx);
+  };
+
+  while (seedHead < seeds.size() || waveHead < wave.size())
+  {
+    size_t idx = 0;
+    if (waveHead == wave.size() ||
+        (seedHead < seeds.size() && seeds[seedHead].first <= map[wave[waveHead]]))
+      idx = seeds[seedHead++].second;
+    else
+      idx = wave[waveHead++];
+    if (settled[idx])
+      continue;
+    settled[idx] = 1;
+
+    const float nextVal = map[idx] + 1.f;
+    const size_t x = idx % dd.width;
+    const size_t y = idx / dd.width;
+    if (x > 0)
+      relax(idx - 1, nextVal);
+    if (x + 1 < dd.width)
+      relax(idx + 1, nextVal);
+    if (y > 0)
+      relax(idx - dd.width, nextVal);
+    if (y + 1 < dd.height)
+      relax(idx + dd.width, nextVal);
+  }
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <vector>
+
+#include "ecsTypes.h"
+
+namespace dmaps
+{
+  constexpr float invalid_tile_value = 1e5f;
+
+  // reference version, rescans the whole grid until nothing changes
+  void process_dmap_scan(std::vector<float> &map, const DungeonData &dd);
+  // wavefront dijkstra over unit-cost floor tiles, any seed values (flee maps are negative)
+  void process_dmap_wavefront(std::vector<float> &map, const DungeonData &dd);
+};
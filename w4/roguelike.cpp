@@ -8,6 +8,8 @@
 #include "dungeonUtils.h"
 #include "dijkstraMapGen.h"
 #include "dmapFollower.h"
+#include <algorithm>
+#include <cfloat>
 
 static flecs::entity create_player_approacher(flecs::entity e)
 {
@@ -42,69 +44,56 @@ static flecs::entity create_hive(flecs::entity e)
 
 static void create_fuzzy_monster_beh(flecs::entity e)
 {
-  e.set(Blackboard{});
-  BehNode *root =
+  // compiled once, shared by every fuzzy monster
+  static const std::shared_ptr<const BehTreeDef> def = compile_beh_tree(
     utility_selector({
       std::make_pair(
-        sequence({
-          find_enemy(e, 4.f, "flee_enemy"),
-          flee(e, "flee_enemy")
+        reactive_sequence({
+          find_enemy(4.f, "flee_enemy"),
+          flee("flee_enemy")
         }),
-        [](Blackboard &bb)
-        {
-          const float hp = bb.get<float>("hp");
-          const float enemyDist = bb.get<float>("enemyDist");
-          return (100.f - hp) * 5.f - 50.f * enemyDist;
-        }
+        // (100 - hp) * 5 - 50 * enemyDist
+        UtilityDesc{0.f, {linear_curve("hp", -5.f, 500.f), linear_curve("enemyDist", -50.f, 0.f)}}
       ),
       std::make_pair(
-        sequence({
-          find_enemy(e, 3.f, "attack_enemy"),
-          move_to_entity(e, "attack_enemy")
+        reactive_sequence({
+          find_enemy(3.f, "attack_enemy"),
+          move_to_entity("attack_enemy")
         }),
-        [](Blackboard &bb)
-        {
-          const float enemyDist = bb.get<float>("enemyDist");
-          return 100.f - 10.f * enemyDist;
-        }
+        UtilityDesc{0.f, {linear_curve("enemyDist", -10.f, 100.f)}}
       ),
       std::make_pair(
-        patrol(e, 2.f, "patrol_pos"),
-        [](Blackboard &)
-        {
-          return 50.f;
-        }
+        patrol(2.f, "patrol_pos"),
+        UtilityDesc{50.f, {}}
       ),
       std::make_pair(
         patch_up(100.f),
-        [](Blackboard &bb)
-        {
-          const float hp = bb.get<float>("hp");
-          return 140.f - hp;
-        }
+        UtilityDesc{0.f, {linear_curve("hp", -1.f, 140.f)}}
       )
-    });
+    }));
+  e.set(Blackboard{});
   e.add<WorldInfoGatherer>();
-  e.set(BehaviourTree{root});
+  create_beh_tree(e, def);
 }
 
 static void create_minotaur_beh(flecs::entity e)
 {
-  e.set(Blackboard{});
-  BehNode *root =
-    selector({
-      sequence({
+  // guards are re-checked each turn so a fleeing or chasing minotaur gives up once the enemy is out of range
+  static const std::shared_ptr<const BehTreeDef> def = compile_beh_tree(
+    reactive_selector({
+      reactive_sequence({
         is_low_hp(50.f),
-        find_enemy(e, 4.f, "flee_enemy"),
-        flee(e, "flee_enemy")
+        find_enemy(4.f, "flee_enemy"),
+        flee("flee_enemy")
       }),
-      sequence({
-        find_enemy(e, 3.f, "attack_enemy"),
-        move_to_entity(e, "attack_enemy")
+      reactive_sequence({
+        find_enemy(3.f, "attack_enemy"),
+        move_to_entity("attack_enemy")
       }),
-      patrol(e, 2.f, "patrol_pos")
-    });
-  e.set(BehaviourTree{root});
+      patrol(2.f, "patrol_pos")
+    }));
+  e.set(Blackboard{});
+  create_beh_tree(e, def);
 }
 
 static Position find_free_dungeon_tile(flecs::world &ecs)
@@ -528,10 +517,91 @@ static void gather_world_info(flecs::world &ecs)
   });
 }
 
+// team positions are bucketed into coarse cells once a turn,
+// so a sleeper only looks at the few cells its wake radius touches
+struct TeamBucket
+{
+  uint64_t cell;
+  Position pos;
+  int team;
+};
+constexpr int wake_cell_size = 8;
+
+static int to_wake_cell(int v)
+{
+  return v >= 0 ? v / wake_cell_size : (v + 1) / wake_cell_size - 1;
+}
+
+static uint64_t wake_cell_key(int cx, int cy)
+{
+  return (uint64_t(uint32_t(cx)) << 32) | uint32_t(cy);
+}
+
+static float closest_enemy_dist(const std::vector<TeamBucket> &buckets, const Position &pos, int team, float radius)
+{
+  float res = FLT_MAX;
+  const int r = int(ceilf(radius));
+  for (int cy = to_wake_cell(pos.y - r); cy <= to_wake_cell(pos.y + r); ++cy)
+    for (int cx = to_wake_cell(pos.x - r); cx <= to_wake_cell(pos.x + r); ++cx)
+    {
+      const uint64_t key = wake_cell_key(cx, cy);
+      auto it = std::lower_bound(buckets.begin(), buckets.end(), key,
+                                 [](const TeamBucket &b, uint64_t k) { return b.cell < k; });
+      for (; it != buckets.end() && it->cell == key; ++it)
+        if (it->team != team)
+          res = std::min(res, dist(pos, it->pos));
+    }
+  return res;
+}
+
+// only trees that are awake get ticked, sleeping ones just check their wake conditions
+static void process_beh_trees(flecs::world &ecs)
+{
+  static auto behTreeUpdate = ecs.query<BehaviourTree, Blackboard, const Position, const Team>();
+  static auto teamsQuery = ecs.query<const Position, const Team>();
+  static std::vector<TeamBucket> teamBuckets;
+  static std::vector<BehAgent> awake;
+  awake.clear();
+  // buckets are only needed by sleepers with a wake radius, most turns have none
+  bool bucketsBuilt = false;
+  auto build_buckets = [&]()
+  {
+    teamBuckets.clear();
+    teamsQuery.each([&](const Position &pos, const Team &team)
+    {
+      teamBuckets.push_back(TeamBucket{wake_cell_key(to_wake_cell(pos.x), to_wake_cell(pos.y)), pos, team.team});
+    });
+    std::sort(teamBuckets.begin(), teamBuckets.end(), [](const TeamBucket &lhs, const TeamBucket &rhs)
+    {
+      return lhs.cell < rhs.cell;
+    });
+    bucketsBuilt = true;
+  };
+  behTreeUpdate.each([&](flecs::entity e, BehaviourTree &bt, Blackboard &bb, const Position &pos, const Team &team)
+  {
+    if (bt.sleep.asleep)
+    {
+      if (bt.sleep.wakeRadius > 0.f && !bucketsBuilt)
+        build_buckets();
+      const float enemyDist = bt.sleep.wakeRadius > 0.f
+                            ? closest_enemy_dist(teamBuckets, pos, team.team, bt.sleep.wakeRadius)
+                            : FLT_MAX;
+      if (!bt.wake_up(bb, enemyDist))
+        return;
+    }
+    awake.push_back(BehAgent{e, &bt, &bb});
+  });
+  // trees sharing a def get their utilities scored together
+  std::stable_sort(awake.begin(), awake.end(), [](const BehAgent &lhs, const BehAgent &rhs)
+  {
+    return std::less<const BehTreeDef *>()(lhs.bt->def.get(), rhs.bt->def.get());
+  });
+  update_beh_trees(ecs, awake);
+}
+
 void process_turn(flecs::world &ecs)
 {
   static auto stateMachineAct = ecs.query<StateMachine>();
-  static auto behTreeUpdate = ecs.query<BehaviourTree, Blackboard>();
   static auto turnIncrementer = ecs.query<TurnCounter>();
   if (is_player_acted(ecs))
   {
@@ -545,10 +615,7 @@ void process_turn(flecs::world &ecs)
         {
           sm.act(0.f, ecs, e);
         });
-        behTreeUpdate.each([&](flecs::entity e, BehaviourTree &bt, Blackboard &bb)
-        {
-          bt.update(ecs, e, bb);
-        });
+        process_beh_trees(ecs);
         process_dmap_followers(ecs);
       });
       turnIncrementer.each([](TurnCounter &tc) { tc.count++; });
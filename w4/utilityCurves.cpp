@@ -0,0 +1,175 @@
+#include "utilityCurves.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cassert>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+UtilityCurve linear_curve(const char *input, float m, float b)
+{
+  return UtilityCurve{CURVE_LINEAR, input, {m, b}};
+}
+
+UtilityCurve quadratic_curve(const char *input, float a, float b, float c)
+{
+  return UtilityCurve{CURVE_QUADRATIC, input, {a, b, c}};
+}
+
+UtilityCurve logistic_curve(const char *input, float height, float steepness, float midpoint, float offset)
+{
+  return UtilityCurve{CURVE_LOGISTIC, input, {height, steepness, midpoint, offset}};
+}
+
+UtilityCurve piecewise_curve(const char *input, std::initializer_list<std::pair<float, float>> knots)
+{
+  UtilityCurve res{CURVE_PIECEWISE, input, {}};
+  if (knots.size() > UtilityCurve::maxKnots)
+  {
+    fprintf(stderr, "utility: piecewise curve over '%s' has %zu knots, only %zu fit\n",
+            input, knots.size(), UtilityCurve::maxKnots);
+    assert(false);
+  }
+  size_t i = 0;
+  for (const std::pair<float, float> &knot : knots)
+  {
+    if (i == UtilityCurve::maxKnots)
+      break;
+    res.params[i * 2 + 0] = knot.first;
+    res.params[i * 2 + 1] = knot.second;
+    ++i;
+  }
+  // repeat the last knot so unused segments are flat
+  for (size_t j = std::max(i, size_t(1)); j < UtilityCurve::maxKnots; ++j)
+  {
+    res.params[j * 2 + 0] = res.params[(j - 1) * 2 + 0];
+    res.params[j * 2 + 1] = res.params[(j - 1) * 2 + 1];
+  }
+  return res;
+}
+
+CompiledCurve compile_curve(const UtilityCurve &curve, uint16_t column, uint16_t utility)
+{
+  CompiledCurve res;
+  res.type = curve.type;
+  res.column = column;
+  res.utility = utility;
+  if (curve.type != CURVE_PIECEWISE)
+  {
+    memcpy(res.params, curve.params, sizeof(curve.params));
+    return res;
+  }
+  // y0 + sum of slope * clamp(x - x_i, 0, width) over segments, no branches per value
+  res.params[0] = curve.params[1];
+  for (size_t i = 0; i + 1 < UtilityCurve::maxKnots; ++i)
+  {
+    const float x0 = curve.params[i * 2 + 0];
+    const float width = curve.params[i * 2 + 2] - x0;
+    const float dy = curve.params[i * 2 + 3] - curve.params[i * 2 + 1];
+    res.params[1 + i * 3 + 0] = x0;
+    res.params[1 + i * 3 + 1] = std::max(width, 0.f);
+    res.params[1 + i * 3 + 2] = width > 0.f ? dy / width : 0.f;
+  }
+  return res;
+}
+
+// 2^x split into exponent bits and a polynomial for the fraction, ~1e-4 relative error at worst.
+// Scalar and vector paths use the same approximation so lanes agree with the tail.
+static float exp_approx(float x)
+{
+  const float t = std::clamp(x, -80.f, 80.f) * 1.44269504f;
+  const int i = int(t) - (t < float(int(t)) ? 1 : 0);
+  const float f = t - float(i);
+  const float p = 1.f + f * (0.6931472f + f * (0.2402265f + f * (0.0555041f + f * (0.0096181f + f * 0.0013334f))));
+  const int32_t bits = (i + 127) << 23;
+  float scale;
+  memcpy(&scale, &bits, sizeof(scale));
+  return p * scale;
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+static __m128 exp_approx4(__m128 x)
+{
+  const __m128 t = _mm_mul_ps(_mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-80.f)), _mm_set1_ps(80.f)),
+                              _mm_set1_ps(1.44269504f));
+  __m128i i = _mm_cvttps_epi32(t);
+  // truncation rounds negatives up, step back to floor
+  i = _mm_add_epi32(i, _mm_castps_si128(_mm_cmplt_ps(t, _mm_cvtepi32_ps(i))));
+  const __m128 f = _mm_sub_ps(t, _mm_cvtepi32_ps(i));
+  __m128 p = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(0.0013334f)), _mm_set1_ps(0.0096181f));
+  p = _mm_add_ps(_mm_mul_ps(f, p), _mm_set1_ps(0.0555041f));
+  p = _mm_add_ps(_mm_mul_ps(f, p), _mm_set1_ps(0.2402265f));
+  p = _mm_add_ps(_mm_mul_ps(f, p), _mm_set1_ps(0.6931472f));
+  p = _mm_add_ps(_mm_mul_ps(f, p), _mm_set1_ps(1.f));
+  const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(i, _mm_set1_epi32(127)), 23));
+  return _mm_mul_ps(p, scale);
+}
+
+static __m128 eval_curve4(const CompiledCurve &curve, __m128 x)
+{
+  const float *p = curve.params;
+  switch (curve.type)
+  {
+    case CURVE_LINEAR:
+      return _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p[0])), _mm_set1_ps(p[1]));
+    case CURVE_QUADRATIC:
+      return _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p[0])), _mm_set1_ps(p[1])), x),
+                        _mm_set1_ps(p[2]));
+    case CURVE_LOGISTIC:
+    {
+      const __m128 e = exp_approx4(_mm_mul_ps(_mm_set1_ps(-p[1]), _mm_sub_ps(x, _mm_set1_ps(p[2]))));
+      return _mm_add_ps(_mm_div_ps(_mm_set1_ps(p[0]), _mm_add_ps(_mm_set1_ps(1.f), e)), _mm_set1_ps(p[3]));
+    }
+    case CURVE_PIECEWISE:
+    {
+      __m128 res = _mm_set1_ps(p[0]);
+      for (size_t i = 0; i + 1 < UtilityCurve::maxKnots; ++i)
+      {
+        const float *seg = p + 1 + i * 3;
+        const __m128 d = _mm_min_ps(_mm_max_ps(_mm_sub_ps(x, _mm_set1_ps(seg[0])), _mm_setzero_ps()),
+                                    _mm_set1_ps(seg[1]));
+        res = _mm_add_ps(res, _mm_mul_ps(d, _mm_set1_ps(seg[2])));
+      }
+      return res;
+    }
+  }
+  return _mm_setzero_ps();
+}
+#endif
+
+static float eval_curve1(const CompiledCurve &curve, float x)
+{
+  const float *p = curve.params;
+  switch (curve.type)
+  {
+    case CURVE_LINEAR:
+      return x * p[0] + p[1];
+    case CURVE_QUADRATIC:
+      return (x * p[0] + p[1]) * x + p[2];
+    case CURVE_LOGISTIC:
+      return p[0] / (1.f + exp_approx(-p[1] * (x - p[2]))) + p[3];
+    case CURVE_PIECEWISE:
+    {
+      float res = p[0];
+      for (size_t i = 0; i + 1 < UtilityCurve::maxKnots; ++i)
+      {
+        const float *seg = p + 1 + i * 3;
+        res += std::min(std::max(x - seg[0], 0.f), seg[1]) * seg[2];
+      }
+      return res;
+    }
+  }
+  return 0.f;
+}
+
+void eval_curve(const CompiledCurve &curve, const float *inputs, float *scores, size_t count)
+{
+  size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+  for (; i + 4 <= count; i += 4)
+    _mm_storeu_ps(scores + i, _mm_add_ps(_mm_loadu_ps(scores + i), eval_curve4(curve, _mm_loadu_ps(inputs + i))));
+#endif
+  for (; i < count; ++i)
+    scores[i] += eval_curve1(curve, inputs[i]);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <initializer_list>
+#include <cstddef>
+#include <cstdint>
+
+enum UtilityCurveType : uint8_t
+{
+  CURVE_LINEAR,
+  CURVE_QUADRATIC,
+  CURVE_LOGISTIC,
+  CURVE_PIECEWISE
+};
+
+// f(x) over a float blackboard var
+struct UtilityCurve
+{
+  static constexpr size_t maxKnots = 4;
+
+  UtilityCurveType type;
+  const char *input;
+  // linear: m, b; quadratic: a, b, c; logistic: height, steepness, midpoint, offset;
+  // piecewise: x0, y0, x1, y1, ... clamped outside of the knots
+  float params[maxKnots * 2] = {};
+};
+
+// utility is the bias plus the sum of its curves
+struct UtilityDesc
+{
+  float bias = 0.f;
+  std::vector<UtilityCurve> curves;
+};
+
+UtilityCurve linear_curve(const char *input, float m, float b);
+UtilityCurve quadratic_curve(const char *input, float a, float b, float c);
+UtilityCurve logistic_curve(const char *input, float height, float steepness, float midpoint, float offset);
+// knots sorted by x, at most maxKnots
+UtilityCurve piecewise_curve(const char *input, std::initializer_list<std::pair<float, float>> knots);
+
+// curve ready for evaluation, piecewise ones are turned into a sum of clamped ramps
+struct CompiledCurve
+{
+  UtilityCurveType type;
+  uint16_t column = 0; // input column
+  uint16_t utility = 0; // score row it adds to
+  float params[1 + (UtilityCurve::maxKnots - 1) * 3] = {};
+};
+
+CompiledCurve compile_curve(const UtilityCurve &curve, uint16_t column, uint16_t utility);
+// scores[i] += f(inputs[i]) for the whole column at once
+void eval_curve(const CompiledCurve &curve, const float *inputs, float *scores, size_t count);
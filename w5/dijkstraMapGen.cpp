@@ -1,6 +1,8 @@
 #include "dijkstraMapGen.h"
 #include "ecsTypes.h"
 #include "dungeonUtils.h"
+#include "dmapSolver.h"
+#include "threadPool.h"
 
 template<typename Callable>
 static void query_dungeon_data(flecs::world &ecs, Callable c)
@@ -10,183 +12,130 @@ static void query_dungeon_data(flecs::world &ecs, Callable c)
   dungeonDataQuery.each(c);
 }
 
-template<typename Callable>
-static void query_characters_positions(flecs::world &ecs, Callable c)
+static size_t tile_idx(const Position &pos, const DungeonData &dd)
 {
-  auto characterPositionQuery = ecs.query<const Position, const Team>();
-
-  characterPositionQuery.each(c);
+  return size_t(pos.y) * dd.width + size_t(pos.x);
 }
 
-constexpr float invalid_tile_value = 1e5f;
-
-static void init_tiles(std::vector<float> &map, const DungeonData &dd)
+static const char *turn_dmap_names[TurnDmaps::Num] =
 {
-  map.resize(dd.width * dd.height);
-  for (float &v : map)
-    v = invalid_tile_value;
-}
-
-// scan version, could be implemented as Dijkstra version as well
-static void process_dmap(std::vector<float> &map, const DungeonData &dd)
+  "approach_map",
+  "hive_map",
+  "spawn_map_knights",
+  "spawn_map_monsters",
+  "team_map_knights",
+  "team_map_monsters",
+  "heal_map",
+  "flee_map"
+};
+
+static void gather_turn_dmap_sources(flecs::world &ecs, const DungeonData &dd, TurnDmaps &maps)
 {
-  bool done = false;
-  auto getMapAt = [&](size_t x, size_t y, float def)
-  {
-    if (x < dd.width && y < dd.width && dd.tiles[y * dd.width + x] == dungeon::floor)
-      return map[y * dd.width + x];
-    return def;
-  };
-  auto getMinNei = [&](size_t x, size_t y)
-  {
-    float val = map[y * dd.width + x];
-    val = std::min(val, getMapAt(x - 1, y + 0, val));
-    val = std::min(val, getMapAt(x + 1, y + 0, val));
-    val = std::min(val, getMapAt(x + 0, y - 1, val));
-    val = std::min(val, getMapAt(x + 0, y + 1, val));
-    return val;
-  };
-  while (!done)
+  auto sourcesQuery = ecs.query<const Position>();
+
+  for (std::vector<size_t> &sources : maps.sources)
+    sources.clear();
+  sourcesQuery.each([&](flecs::entity e, const Position &pos)
   {
-    done = true;
-    for (size_t y = 0; y < dd.height; ++y)
-      for (size_t x = 0; x < dd.width; ++x)
+    const size_t idx = tile_idx(pos, dd);
+    if (const Team *t = e.get<Team>())
+    {
+      if (t->team == 0) // player team hardcode
       {
-        const size_t i = y * dd.width + x;
-        if (dd.tiles[i] != dungeon::floor)
-          continue;
-        const float myVal = getMapAt(x, y, invalid_tile_value);
-        const float minVal = getMinNei(x, y);
-        if (minVal < myVal - 1.f)
-        {
-          map[i] = minVal + 1.f;
-          done = false;
-        }
+        maps.sources[TurnDmaps::Approach].push_back(idx);
+        maps.sources[TurnDmaps::TeamKnights].push_back(idx);
       }
-  }
-}
-
-void dmaps::gen_player_approach_map(flecs::world &ecs, std::vector<float> &map)
-{
-  query_dungeon_data(ecs, [&](const DungeonData &dd)
-  {
-    init_tiles(map, dd);
-    query_characters_positions(ecs, [&](const Position &pos, const Team &t)
+      else if (t->team == 1)
+        maps.sources[TurnDmaps::TeamMonsters].push_back(idx);
+    }
+    if (e.has<Hive>())
+      maps.sources[TurnDmaps::Hive].push_back(idx);
+    if (const SpawnPoint *sp = e.get<SpawnPoint>())
     {
-      if (t.team == 0) // player team hardcode
-        map[pos.y * dd.width + pos.x] = 0.f;
-    });
-    process_dmap(map, dd);
+      if (sp->team == 0)
+        maps.sources[TurnDmaps::SpawnKnights].push_back(idx);
+      else if (sp->team == 1)
+        maps.sources[TurnDmaps::SpawnMonsters].push_back(idx);
+    }
+    if (e.has<HealAmount>())
+      maps.sources[TurnDmaps::Heal].push_back(idx);
   });
 }
 
-void dmaps::gen_player_flee_map(flecs::world &ecs, std::vector<float> &map)
+// flee map is the whole approach map rescaled, so it is rebuilt each time the approach map changes
+static void gen_player_flee_map(const std::vector<float> &approach_map, const DungeonData &dd, std::vector<float> &map)
 {
-  gen_player_approach_map(ecs, map);
+  map = approach_map;
   for (float &v : map)
-    if (v < invalid_tile_value)
+    if (v < dmaps::invalid_tile_value)
       v *= -1.2f;
-  query_dungeon_data(ecs, [&](const DungeonData &dd)
-  {
-    process_dmap(map, dd);
-  });
+  dmaps::process_dmap(map, dd);
 }
 
-void dmaps::gen_hive_pack_map(flecs::world &ecs, std::vector<float> &map)
+void dmaps::gen_turn_maps(flecs::world &ecs)
 {
-  auto hiveQuery = ecs.query<const Position, const Hive>();
   query_dungeon_data(ecs, [&](const DungeonData &dd)
   {
-    init_tiles(map, dd);
-    hiveQuery.each([&](const Position &pos, const Hive &)
+    ecs.entity("turn_dmaps").insert([&](TurnDmaps &maps)
     {
-      map[pos.y * dd.width + pos.x] = 0.f;
-    });
-    process_dmap(map, dd);
-  });
-}
+      gather_turn_dmap_sources(ecs, dd, maps);
 
-void dmaps::gen_spawn_points_map(flecs::world& ecs, std::vector<float>& map, int team)
-{
-    auto spawnQuery = ecs.query<const Position, const SpawnPoint>();
-
-    query_dungeon_data(ecs, [&](const DungeonData& dd)
+      // maps don't depend on each other (except flee on approach), so each one is a job
+      ThreadPool &pool = get_worker_pool();
+      for (size_t i = 0; i < TurnDmaps::NumDynamic; ++i)
+        pool.push([&, i]()
         {
-            init_tiles(map, dd);
-
-            spawnQuery.each([&](const Position& pos, const SpawnPoint& sp)
-                {
-                    if (sp.team == team)
-                        map[pos.y * dd.width + pos.x] = 0.f;
-                });
-
-            process_dmap(map, dd);
+          sync_sources(maps.dynamic[i], maps.sources[i]);
+          maps.changed[i] = repair_dmap(maps.dynamic[i], dd);
+          if (!maps.changed[i])
+            return;
+          maps.published[i].map = maps.dynamic[i].map;
+          gen_flow_field(maps.published[i].map, dd, maps.published[i].flow);
+          if (i == TurnDmaps::Approach)
+          {
+            DijkstraMapData &flee = maps.published[TurnDmaps::Flee];
+            gen_player_flee_map(maps.dynamic[i].map, dd, flee.map);
+            gen_flow_field(flee.map, dd, flee.flow);
+          }
         });
-}
-
-void dmaps::gen_team_positions_map(flecs::world& ecs, std::vector<float>& map, int team)
-{
-    auto teamQuery = ecs.query<const Position, const Team>();
+      pool.wait();
+      maps.changed[TurnDmaps::Flee] = maps.changed[TurnDmaps::Approach];
 
-    query_dungeon_data(ecs, [&](const DungeonData& dd)
+      for (size_t i = 0; i < TurnDmaps::Num; ++i)
+        if (maps.changed[i])
         {
-            init_tiles(map, dd);
-
-            teamQuery.each([&](const Position& pos, const Team& t)
-                {
-                    if (t.team == team)
-                        map[pos.y * dd.width + pos.x] = 0.f;
-                });
-
-            process_dmap(map, dd);
-        });
+          maps.published[i].version = ++maps.versions[i];
+          ecs.entity(turn_dmap_names[i]).set(std::move(maps.published[i]));
+        }
+    });
+  });
 }
 
-void dmaps::gen_heal_points_map(flecs::world& ecs, std::vector<float>& map)
+void dmaps::gen_flow_field(const std::vector<float> &map, const DungeonData &dd, FlowField &flow)
 {
-    auto healQuery = ecs.query<const Position, const HealAmount>();
-
-    query_dungeon_data(ecs, [&](const DungeonData& dd)
+  flow.reset(dd.width * dd.height);
+  for (size_t y = 0; y < dd.height; ++y)
+    for (size_t x = 0; x < dd.width; ++x)
+    {
+      const size_t idx = y * dd.width + x;
+      float minVal = map[idx];
+      int dir = EA_NOP;
+      auto check = [&](size_t nidx, int move)
+      {
+        if (map[nidx] < minVal)
         {
-            init_tiles(map, dd);
-
-            healQuery.each([&](const Position& pos, const HealAmount&)
-                {
-                    /*printf("Heal at (%d, %d)\n", int(pos.x), int(pos.y));*/
-                    map[pos.y * dd.width + pos.x] = 0.f;
-                });
-
-            process_dmap(map, dd);
-        });
-}
-
-void dmaps::generate_flow_map(const std::vector<float>& dijkstra_map, const DungeonData& dd, std::vector<Position>& flow_map) {
-    flow_map.resize(dd.width * dd.height);
-
-    for (size_t y = 0; y < dd.height; ++y) {
-        for (size_t x = 0; x < dd.width; ++x) {
-            size_t idx = y * dd.width + x;
-            float min_val = dijkstra_map[idx];
-            Position dir = { 0, 0 };
-
-            if (x > 0 && dijkstra_map[idx - 1] < min_val) {
-                min_val = dijkstra_map[idx - 1];
-                dir = { -1, 0 };
-            }
-            if (x < dd.width - 1 && dijkstra_map[idx + 1] < min_val) {
-                min_val = dijkstra_map[idx + 1];
-                dir = { 1, 0 };
-            }
-            if (y > 0 && dijkstra_map[idx - dd.width] < min_val) {
-                min_val = dijkstra_map[idx - dd.width];
-                dir = { 0, -1 };
-            }
-            if (y < dd.height - 1 && dijkstra_map[idx + dd.width] < min_val) {
-                min_val = dijkstra_map[idx + dd.width];
-                dir = { 0, 1 };
-            }
-
-            flow_map[idx] = dir;
+          minVal = map[nidx];
+          dir = move;
         }
+      };
+      if (x > 0)
+        check(idx - 1, EA_MOVE_LEFT);
+      if (x + 1 < dd.width)
+        check(idx + 1, EA_MOVE_RIGHT);
+      if (y > 0)
+        check(idx - dd.width, EA_MOVE_UP);
+      if (y + 1 < dd.height)
+        check(idx + dd.width, EA_MOVE_DOWN);
+      flow.set(idx, dir);
     }
-}
\ No newline at end of file
+}
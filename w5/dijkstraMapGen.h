@@ -3,16 +3,38 @@
 #include <flecs.h>
 
 #include "ecsTypes.h"
+#include "dynamicDmap.h"
 
-namespace dmaps
+// state of every map rebuilt on each turn, lives on the "turn_dmaps" entity
+struct TurnDmaps
 {
-  void gen_player_approach_map(flecs::world &ecs, std::vector<float> &map);
-  void gen_player_flee_map(flecs::world &ecs, std::vector<float> &map);
-  void gen_hive_pack_map(flecs::world &ecs, std::vector<float> &map);
+  enum Map
+  {
+    Approach = 0,
+    Hive,
+    SpawnKnights,
+    SpawnMonsters,
+    TeamKnights,
+    TeamMonsters,
+    Heal,
+    NumDynamic,
+    Flee = NumDynamic, // derived from approach map
+    Num
+  };
+
+  DynamicDmap dynamic[NumDynamic];
+  std::vector<size_t> sources[NumDynamic];
+  DijkstraMapData published[Num];
+  bool changed[Num] = {};
+  uint32_t versions[Num] = {};
+};
 
-  void gen_spawn_points_map(flecs::world& ecs, std::vector<float>& map, int team);
-  void gen_team_positions_map(flecs::world& ecs, std::vector<float>& map, int team);
-  void gen_heal_points_map(flecs::world& ecs, std::vector<float>& map);
+namespace dmaps
+{
+  // gathers sources of all turn maps in one pass over the world, repairs the maps
+  // on the worker pool and publishes changed ones to their DijkstraMapData entities
+  void gen_turn_maps(flecs::world &ecs);
 
-  void generate_flow_map(const std::vector<float>& dijkstra_map, const DungeonData& dd, std::vector<Position>& flow_map);
+  // downhill move for every tile, built once per published map so followers only look it up
+  void gen_flow_field(const std::vector<float> &map, const DungeonData &dd, FlowField &flow);
 };
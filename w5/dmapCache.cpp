@@ -0,0 +1,158 @@
+#include "dmapCache.h"
+#include "dmapSolver.h"
+#include "threadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cassert>
+
+static uint64_t mix_bits(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+static uint64_t float_bits(float f)
+{
+  uint32_t bits = 0;
+  memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+DmapWeights dmaps::make_weights(const flecs::world &ecs, std::initializer_list<NamedWeight> weights)
+{
+  DmapWeights wt;
+  for (const NamedWeight &w : weights)
+  {
+    if (wt.numWeights == DmapWeights::maxWeights)
+    {
+      fprintf(stderr, "dmaps: too many weights, '%s' doesn't fit in %zu\n", w.map, DmapWeights::maxWeights);
+      assert(false);
+      break;
+    }
+    wt.weights[wt.numWeights++] = {ecs.entity(w.map).id(), w.mult, w.pow};
+  }
+  return wt;
+}
+
+uint64_t dmaps::weights_signature(const DmapWeights &wt)
+{
+  // sum of per-weight hashes doesn't depend on the order weights were given in
+  uint64_t sig = 0;
+  for (const DmapWeights::WtData &w : wt)
+    sig += mix_bits(mix_bits(w.map) ^ (float_bits(w.mult) | (float_bits(w.pow) << 32)));
+  return sig;
+}
+
+static bool same_weight(const DmapWeights::WtData &lhs, const DmapWeights::WtData &rhs)
+{
+  return lhs.map == rhs.map && float_bits(lhs.mult) == float_bits(rhs.mult) && float_bits(lhs.pow) == float_bits(rhs.pow);
+}
+
+bool dmaps::same_weights(const DmapWeights &lhs, const DmapWeights &rhs)
+{
+  if (lhs.numWeights != rhs.numWeights)
+    return false;
+  // every weight shows up as many times on both sides
+  for (const DmapWeights::WtData &w : lhs)
+  {
+    auto same = [&](const DmapWeights::WtData &o) { return same_weight(w, o); };
+    if (std::count_if(lhs.begin(), lhs.end(), same) != std::count_if(rhs.begin(), rhs.end(), same))
+      return false;
+  }
+  return true;
+}
+
+using DmapInputs = std::vector<std::pair<const DijkstraMapData *, DmapWeights::WtData>>;
+
+static DmapInputs gather_inputs(flecs::world &ecs, const DmapWeights &wt)
+{
+  DmapInputs inputs;
+  for (const DmapWeights::WtData &w : wt)
+    inputs.emplace_back(ecs.entity(w.map).get<DijkstraMapData>(), w);
+  return inputs;
+}
+
+static bool inputs_changed(const CombinedDmap &cmap, const DmapInputs &inputs)
+{
+  if (cmap.inputVersions.size() != inputs.size())
+    return true;
+  for (size_t i = 0; i < inputs.size(); ++i)
+    if (cmap.inputVersions[i] != (inputs[i].first ? inputs[i].first->version : 0u))
+      return true;
+  return false;
+}
+
+static void combine_dmaps(const DmapInputs &inputs, const DungeonData &dd, CombinedDmap &cmap)
+{
+  const size_t size = dd.width * dd.height;
+  std::vector<float> &map = cmap.data.map;
+  map.assign(size, 0.f);
+  cmap.inputVersions.clear();
+  for (const auto &input : inputs)
+  {
+    cmap.inputVersions.push_back(input.first ? input.first->version : 0u);
+    if (!input.first || input.first->map.size() != size)
+      continue;
+    const std::vector<float> &src = input.first->map;
+    const float mult = input.second.mult;
+    const float pow = input.second.pow;
+    for (size_t i = 0; i < size; ++i)
+    {
+      const float v = src[i];
+      map[i] += v < dmaps::invalid_tile_value ? powf(v * mult, pow) : v;
+    }
+  }
+  cmap.data.version++;
+  cmap.built = true;
+}
+
+void dmaps::update_combined_dmaps(flecs::world &ecs)
+{
+  auto dungeonDataQuery = ecs.query<const DungeonData>();
+  auto weightsQuery = ecs.query<const DmapWeights, const VisualiseMap>();
+
+  dungeonDataQuery.each([&](const DungeonData &dd)
+  {
+    ecs.entity("combined_dmaps").insert([&](CombinedDmapCache &cache)
+    {
+      for (auto &pair : cache.maps)
+        pair.second.used = false;
+
+      // inputs are only read by the jobs, nothing touches the world until wait()
+      ThreadPool &pool = get_worker_pool();
+      weightsQuery.each([&](const DmapWeights &wt, const VisualiseMap)
+      {
+        CombinedDmap &cmap = cache.maps[wt];
+        if (cmap.used)
+          return;
+        cmap.used = true;
+        DmapInputs inputs = gather_inputs(ecs, wt);
+        if (cmap.built && !inputs_changed(cmap, inputs))
+          return;
+        pool.push([&cmap, &dd, inputs = std::move(inputs)]()
+        {
+          combine_dmaps(inputs, dd, cmap);
+        });
+      });
+      pool.wait();
+
+      for (auto it = cache.maps.begin(); it != cache.maps.end();)
+        if (!it->second.used)
+          it = cache.maps.erase(it);
+        else
+          ++it;
+    });
+  });
+}
+
+const DijkstraMapData *dmaps::find_combined_dmap(const CombinedDmapCache &cache, const DmapWeights &wt)
+{
+  auto itf = cache.maps.find(wt);
+  return itf != cache.maps.end() ? &itf->second.data : nullptr;
+}
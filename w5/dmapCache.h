@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <initializer_list>
+#include <flecs.h>
+
+#include "ecsTypes.h"
+
+namespace dmaps
+{
+  // equal weights give equal signatures regardless of their order
+  uint64_t weights_signature(const DmapWeights &wt);
+  // same set of weights, regardless of their order
+  bool same_weights(const DmapWeights &lhs, const DmapWeights &rhs);
+};
+
+struct DmapWeightsHash
+{
+  size_t operator()(const DmapWeights &wt) const { return dmaps::weights_signature(wt); }
+};
+
+struct DmapWeightsEqual
+{
+  bool operator()(const DmapWeights &lhs, const DmapWeights &rhs) const { return dmaps::same_weights(lhs, rhs); }
+};
+
+// weighted sum of several turn maps, only built for visualised DmapWeights (followers vote per map),
+// the flow field isn't filled in
+struct CombinedDmap
+{
+  std::vector<uint32_t> inputVersions; // versions of the input maps it was built from
+  DijkstraMapData data;
+  bool built = false;
+  bool used = false;
+};
+
+// lives on the "combined_dmaps" entity, keyed by the weights so colliding signatures don't share a map
+struct CombinedDmapCache
+{
+  std::unordered_map<DmapWeights, CombinedDmap, DmapWeightsHash, DmapWeightsEqual> maps;
+};
+
+namespace dmaps
+{
+  struct NamedWeight
+  {
+    const char *map;
+    float mult = 1.f;
+    float pow = 1.f;
+  };
+  // resolves map names to their entities, at most DmapWeights::maxWeights of them
+  DmapWeights make_weights(const flecs::world &ecs, std::initializer_list<NamedWeight> weights);
+
+  // rebuilds the combined maps of visualised DmapWeights whose inputs got a new version, drops the unused ones
+  void update_combined_dmaps(flecs::world &ecs);
+  // nullptr if not built yet
+  const DijkstraMapData *find_combined_dmap(const CombinedDmapCache &cache, const DmapWeights &wt);
+};
@@ -0,0 +1,278 @@
+#include "dmapSolver.h"
+#include "dungeonUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+void dmaps::process_dmap_scan(std::vector<float> &map, const DungeonData &dd)
+{
+  bool done = false;
+  auto getMapAt = [&](size_t x, size_t y, float def)
+  {
+    if (x < dd.width && y < dd.width && dd.tiles[y * dd.width + x] == dungeon::floor)
+      return map[y * dd.width + x];
+    return def;
+  };
+  auto getMinNei = [&](size_t x, size_t y)
+  {
+    float val = map[y * dd.width + x];
+    val = std::min(val, getMapAt(x - 1, y + 0, val));
+    val = std::min(val, getMapAt(x + 1, y + 0, val));
+    val = std::min(val, getMapAt(x + 0, y - 1, val));
+    val = std::min(val, getMapAt(x + 0, y + 1, val));
+    return val;
+  };
+  while (!done)
+  {
+    done = true;
+    for (size_t y = 0; y < dd.height; ++y)
+      for (size_t x = 0; x < dd.width; ++x)
+      {
+        const size_t i = y * dd.width + x;
+        if (dd.tiles[i] != dungeon::floor)
+          continue;
+        const float myVal = getMapAt(x, y, invalid_tile_value);
+        const float minVal = getMinNei(x, y);
+        if (minVal < myVal - 1.f)
+        {
+          map[i] = minVal + 1.f;
+          done = false;
+        }
+      }
+  }
+}
+
+// All edges cost exactly 1, so popped values never decrease and every value pushed
+// to the wave is (last popped + 1). That makes the wave a sorted FIFO, and merging it
+// with the sorted seed list gives an exact priority queue without a heap.
+// Every floor tile enters the wave at most once.
+void dmaps::propagate_dmap(std::vector<float> &map, const DungeonData &dd, std::vector<std::pair<float, size_t>> &seeds)
+{
+  std::stable_sort(seeds.begin(), seeds.end(), [](const auto &lhs, const auto &rhs)
+  {
+    return lhs.first < rhs.first;
+  });
+
+  std::vector<size_t> wave;
+  size_t waveHead = 0;
+  size_t seedHead = 0;
+
+  auto relax = [&](size_t idx, float val)
+  {
+    if (dd.tiles[idx] != dungeon::floor || !(val < map[idx]))
+      return;
+    map[idx] = val;
+    wave.push_back(idx);
+  };
+
+  while (seedHead < seeds.size() || waveHead < wave.size())
+  {
+    size_t idx = 0;
+    if (waveHead == wave.size() ||
+        (seedHead < seeds.size() && seeds[seedHead].first <= map[wave[waveHead]]))
+    {
+      const std::pair<float, size_t> &seed = seeds[seedHead++];
+      idx = seed.second;
+      if (map[idx] != seed.first) // already reached by the wave with a lower value
+        continue;
+    }
+    else
+      idx = wave[waveHead++];
+
+    const float nextVal = map[idx] + 1.f;
+    const size_t x = idx % dd.width;
+    const size_t y = idx / dd.width;
+    if (x > 0)
+      relax(idx - 1, nextVal);
+    if (x + 1 < dd.width)
+      relax(idx + 1, nextVal);
+    if (y > 0)
+      relax(idx - dd.width, nextVal);
+    if (y + 1 < dd.height)
+      relax(idx + dd.width, nextVal);
+  }
+}
+
+void dmaps::process_dmap_wavefront(std::vector<float> &map, const DungeonData &dd)
+{
+  std::vector<std::pair<float, size_t>> seeds;
+  for (size_t i = 0; i < map.size(); ++i)
+    if (dd.tiles[i] == dungeon::floor && map[i] < invalid_tile_value)
+      seeds.emplace_back(map[i], i);
+  propagate_dmap(map, dd, seeds);
+}
+
+// Walls hold a value so large that +1 from it never improves anything, and the
+// mask row is -wall for floor and +wall for walls, so max(nei + 1, mask) is the
+// candidate for floor tiles and keeps walls intact without branching.
+constexpr float sweep_wall_value = 1e30f;
+
+// relax row against its neighbour row (above or below), true if anything improved
+static bool sweep_row_vertical(float *row, const float *nei, const float *mask, size_t n)
+{
+  size_t x = 0;
+  bool changed = false;
+#if defined(__AVX__)
+  const __m256 one8 = _mm256_set1_ps(1.f);
+  for (; x + 8 <= n; x += 8)
+  {
+    const __m256 cur = _mm256_loadu_ps(row + x);
+    const __m256 cand = _mm256_max_ps(_mm256_add_ps(_mm256_loadu_ps(nei + x), one8), _mm256_loadu_ps(mask + x));
+    const __m256 res = _mm256_min_ps(cur, cand);
+    changed |= _mm256_movemask_ps(_mm256_cmp_ps(res, cur, _CMP_LT_OQ)) != 0;
+    _mm256_storeu_ps(row + x, res);
+  }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  const __m128 one4 = _mm_set1_ps(1.f);
+  for (; x + 4 <= n; x += 4)
+  {
+    const __m128 cur = _mm_loadu_ps(row + x);
+    const __m128 cand = _mm_max_ps(_mm_add_ps(_mm_loadu_ps(nei + x), one4), _mm_loadu_ps(mask + x));
+    const __m128 res = _mm_min_ps(cur, cand);
+    changed |= _mm_movemask_ps(_mm_cmplt_ps(res, cur)) != 0;
+    _mm_storeu_ps(row + x, res);
+  }
+#endif
+  for (; x < n; ++x)
+  {
+    const float cand = std::max(nei[x] + 1.f, mask[x]);
+    if (cand < row[x])
+    {
+      row[x] = cand;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+// left to right and back, each tile depends on the previous one so this part stays scalar
+static bool sweep_row_horizontal(float *row, const float *mask, size_t n)
+{
+  bool changed = false;
+  for (size_t x = 1; x < n; ++x)
+  {
+    const float cand = std::max(row[x - 1] + 1.f, mask[x]);
+    if (cand < row[x])
+    {
+      row[x] = cand;
+      changed = true;
+    }
+  }
+  for (size_t x = n - 1; x-- > 0;)
+  {
+    const float cand = std::max(row[x + 1] + 1.f, mask[x]);
+    if (cand < row[x])
+    {
+      row[x] = cand;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+void dmaps::process_dmap_sweep(std::vector<float> &map, const DungeonData &dd)
+{
+  if (dd.width == 0 || dd.height == 0)
+    return;
+  // rows are padded with walls up to the widest vector size
+  const size_t stride = (dd.width + 7) & ~size_t(7);
+  std::vector<float> grid(stride * dd.height, sweep_wall_value);
+  std::vector<float> mask(stride * dd.height, sweep_wall_value);
+  for (size_t y = 0; y < dd.height; ++y)
+    for (size_t x = 0; x < dd.width; ++x)
+      if (dd.tiles[y * dd.width + x] == dungeon::floor)
+      {
+        grid[y * stride + x] = map[y * dd.width + x];
+        mask[y * stride + x] = -sweep_wall_value;
+      }
+
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (size_t y = 0; y < dd.height; ++y)
+    {
+      float *row = grid.data() + y * stride;
+      const float *rowMask = mask.data() + y * stride;
+      if (y > 0)
+        changed |= sweep_row_vertical(row, row - stride, rowMask, stride);
+      changed |= sweep_row_horizontal(row, rowMask, stride);
+    }
+    for (size_t y = dd.height; y-- > 0;)
+    {
+      float *row = grid.data() + y * stride;
+      const float *rowMask = mask.data() + y * stride;
+      if (y + 1 < dd.height)
+        changed |= sweep_row_vertical(row, row + stride, rowMask, stride);
+      changed |= sweep_row_horizontal(row, rowMask, stride);
+    }
+  }
+
+  for (size_t y = 0; y < dd.height; ++y)
+    for (size_t x = 0; x < dd.width; ++x)
+      if (dd.tiles[y * dd.width + x] == dungeon::floor)
+        map[y * dd.width + x] = grid[y * stride + x];
+}
+
+// Wavefront only ever touches floor tiles, sweeps touch everything but vectorize
+// and don't need sorted seeds, so they win on open levels.
+void dmaps::process_dmap(std::vector<float> &map, const DungeonData &dd)
+{
+  const size_t numFloor = size_t(std::count(dd.tiles.begin(), dd.tiles.end(), dungeon::floor));
+  if (numFloor * 10 >= dd.tiles.size() * 9)
+    process_dmap_sweep(map, dd);
+  else
+    process_dmap_wavefront(map, dd);
+}
+
+void dmaps::bench_process_dmap(const DungeonData &dd, size_t num_runs)
+{
+  // two sources on the opposite ends of the level, like two team members
+  std::vector<float> seedMap(dd.width * dd.height, invalid_tile_value);
+  auto firstFloor = std::find(dd.tiles.begin(), dd.tiles.end(), dungeon::floor);
+  auto lastFloor = std::find(dd.tiles.rbegin(), dd.tiles.rend(), dungeon::floor);
+  if (firstFloor == dd.tiles.end())
+    return;
+  seedMap[size_t(firstFloor - dd.tiles.begin())] = 0.f;
+  seedMap[size_t(dd.tiles.rend() - lastFloor) - 1] = 0.f;
+
+  auto run = [&](const char *name, const std::vector<float> &init, auto process, std::vector<float> &res)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_runs; ++i)
+    {
+      res = init;
+      process(res, dd);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    printf("%16s: %9.3f ms/map\n", name, ms / double(std::max(num_runs, size_t(1))));
+  };
+
+  printf("dmap bench %zux%zu, %zu runs\n", dd.width, dd.height, num_runs);
+  std::vector<float> scanMap;
+  std::vector<float> waveMap;
+  run("approach scan", seedMap, process_dmap_scan, scanMap);
+  run("approach wave", seedMap, process_dmap_wavefront, waveMap);
+  printf("approach maps %s\n", scanMap == waveMap ? "match" : "DIFFER");
+  std::vector<float> sweepMap;
+  run("approach sweep", seedMap, process_dmap_sweep, sweepMap);
+  printf("approach sweep %s\n", sweepMap == waveMap ? "match" : "DIFFER");
+
+  // same transform as gen_player_flee_map
+  std::vector<float> fleeSeeds = waveMap;
+  for (float &v : fleeSeeds)
+    if (v < invalid_tile_value)
+      v *= -1.2f;
+  run("flee scan", fleeSeeds, process_dmap_scan, scanMap);
+  run("flee wave", fleeSeeds, process_dmap_wavefront, waveMap);
+  printf("flee maps %s\n", scanMap == waveMap ? "match" : "DIFFER");
+  run("flee sweep", fleeSeeds, process_dmap_sweep, sweepMap);
+  printf("flee sweep %s\n", sweepMap == waveMap ? "match" : "DIFFER");
+}
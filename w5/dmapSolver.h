@@ -0,0 +1,23 @@
+#pragma once
+#include <vector>
+
+#include "ecsTypes.h"
+
+namespace dmaps
+{
+  constexpr float invalid_tile_value = 1e5f;
+
+  // full rebuild from the seeds already in the map, picks a kernel suited to the level
+  void process_dmap(std::vector<float> &map, const DungeonData &dd);
+
+  // reference version, rescans the whole grid until nothing changes
+  void process_dmap_scan(std::vector<float> &map, const DungeonData &dd);
+  // wavefront dijkstra over unit-cost floor tiles, any seed values (flee maps are negative)
+  void process_dmap_wavefront(std::vector<float> &map, const DungeonData &dd);
+  // forward/backward row sweeps over a wall-masked grid until nothing changes, SIMD across rows
+  void process_dmap_sweep(std::vector<float> &map, const DungeonData &dd);
+  // spreads the wave only from the given (value, tile) seeds, leaves the rest of the map as is
+  void propagate_dmap(std::vector<float> &map, const DungeonData &dd, std::vector<std::pair<float, size_t>> &seeds);
+
+  void bench_process_dmap(const DungeonData &dd, size_t num_runs);
+};
@@ -0,0 +1,153 @@
+#include "dynamicDmap.h"
+#include "dmapSolver.h"
+#include "dungeonUtils.h"
+#include <algorithm>
+
+template<typename Callable>
+static void for_each_floor_neighbour(const DungeonData &dd, size_t idx, Callable c)
+{
+  const size_t x = idx % dd.width;
+  const size_t y = idx / dd.width;
+  auto check = [&](size_t nidx)
+  {
+    if (dd.tiles[nidx] == dungeon::floor)
+      c(nidx);
+  };
+  if (x > 0)
+    check(idx - 1);
+  if (x + 1 < dd.width)
+    check(idx + 1);
+  if (y > 0)
+    check(idx - dd.width);
+  if (y + 1 < dd.height)
+    check(idx + dd.width);
+}
+
+void dmaps::add_source(DynamicDmap &dmap, size_t tile)
+{
+  dmap.sources.insert(std::upper_bound(dmap.sources.begin(), dmap.sources.end(), tile), tile);
+  dmap.addedSources.push_back(tile);
+}
+
+void dmaps::remove_source(DynamicDmap &dmap, size_t tile)
+{
+  auto itf = std::lower_bound(dmap.sources.begin(), dmap.sources.end(), tile);
+  if (itf == dmap.sources.end() || *itf != tile)
+    return;
+  dmap.sources.erase(itf);
+  dmap.removedSources.push_back(tile);
+}
+
+void dmaps::move_source(DynamicDmap &dmap, size_t from, size_t to)
+{
+  remove_source(dmap, from);
+  add_source(dmap, to);
+}
+
+void dmaps::sync_sources(DynamicDmap &dmap, std::vector<size_t> tiles)
+{
+  std::sort(tiles.begin(), tiles.end());
+  std::set_difference(tiles.begin(), tiles.end(), dmap.sources.begin(), dmap.sources.end(),
+                      std::back_inserter(dmap.addedSources));
+  std::set_difference(dmap.sources.begin(), dmap.sources.end(), tiles.begin(), tiles.end(),
+                      std::back_inserter(dmap.removedSources));
+  dmap.sources = std::move(tiles);
+}
+
+static void rebuild_dmap(DynamicDmap &dmap, const DungeonData &dd)
+{
+  const size_t size = dd.width * dd.height;
+  dmap.map.assign(size, dmaps::invalid_tile_value);
+  dmap.sourceCount.assign(size, 0);
+  dmap.affected.assign(size, 0);
+  for (size_t tile : dmap.sources)
+  {
+    dmap.sourceCount[tile]++;
+    dmap.map[tile] = 0.f;
+  }
+  dmaps::process_dmap(dmap.map, dd);
+}
+
+bool dmaps::repair_dmap(DynamicDmap &dmap, const DungeonData &dd)
+{
+  if (dmap.map.size() != dd.width * dd.height)
+    dmap.needsRebuild = true;
+  if (dmap.needsRebuild)
+  {
+    rebuild_dmap(dmap, dd);
+    dmap.addedSources.clear();
+    dmap.removedSources.clear();
+    dmap.needsRebuild = false;
+    return true;
+  }
+  if (dmap.addedSources.empty() && dmap.removedSources.empty())
+    return false;
+
+  for (size_t tile : dmap.addedSources)
+    dmap.sourceCount[tile]++;
+  for (size_t tile : dmap.removedSources)
+    dmap.sourceCount[tile]--;
+
+  // Increase: every tile whose shortest path went through a removed source is
+  // reachable from it by steps of exactly +1, collect and invalidate them.
+  std::vector<size_t> &affectedList = dmap.affectedList;
+  affectedList.clear();
+  auto markAffected = [&](size_t idx)
+  {
+    dmap.affected[idx] = 1;
+    affectedList.push_back(idx);
+  };
+  for (size_t tile : dmap.removedSources)
+  {
+    if (dmap.sourceCount[tile] > 0 || dmap.affected[tile] || dmap.map[tile] >= invalid_tile_value)
+      continue;
+    if (dd.tiles[tile] == dungeon::floor)
+      markAffected(tile);
+    else
+      dmap.map[tile] = invalid_tile_value; // never spread anything
+  }
+  for (size_t i = 0; i < affectedList.size(); ++i)
+  {
+    const float nextVal = dmap.map[affectedList[i]] + 1.f;
+    for_each_floor_neighbour(dd, affectedList[i], [&](size_t nidx)
+    {
+      if (!dmap.affected[nidx] && dmap.sourceCount[nidx] == 0 && dmap.map[nidx] == nextVal)
+        markAffected(nidx);
+    });
+  }
+  for (size_t idx : affectedList)
+    dmap.map[idx] = invalid_tile_value;
+
+  // the unaffected border of the region is still correct, restart the wave from it
+  std::vector<std::pair<float, size_t>> seeds;
+  for (size_t idx : affectedList)
+  {
+    float best = invalid_tile_value;
+    for_each_floor_neighbour(dd, idx, [&](size_t nidx)
+    {
+      if (!dmap.affected[nidx])
+        best = std::min(best, dmap.map[nidx] + 1.f);
+    });
+    if (best < invalid_tile_value)
+    {
+      dmap.map[idx] = best;
+      seeds.emplace_back(best, idx);
+    }
+  }
+  for (size_t idx : affectedList)
+    dmap.affected[idx] = 0;
+
+  // Decrease: new sources simply start their own wave
+  for (size_t tile : dmap.addedSources)
+    if (dmap.map[tile] > 0.f)
+    {
+      dmap.map[tile] = 0.f;
+      if (dd.tiles[tile] == dungeon::floor)
+        seeds.emplace_back(0.f, tile);
+    }
+
+  propagate_dmap(dmap.map, dd, seeds);
+  dmap.addedSources.clear();
+  dmap.removedSources.clear();
+  return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "ecsTypes.h"
+
+// Dijkstra map that keeps its distance field between turns.
+// Sources are zero-valued tiles, changes to them are queued as events and
+// repair_dmap only touches the region those events affect.
+struct DynamicDmap
+{
+  std::vector<float> map;
+  std::vector<uint16_t> sourceCount; // several sources can stand on the same tile
+  std::vector<size_t> sources; // sorted, with duplicates
+
+  std::vector<size_t> addedSources;
+  std::vector<size_t> removedSources;
+  bool needsRebuild = true;
+
+  // scratch for repairs, kept to avoid reallocating every turn
+  std::vector<uint8_t> affected;
+  std::vector<size_t> affectedList;
+};
+
+namespace dmaps
+{
+  void add_source(DynamicDmap &dmap, size_t tile);
+  void remove_source(DynamicDmap &dmap, size_t tile);
+  void move_source(DynamicDmap &dmap, size_t from, size_t to);
+  // diffs the given tiles against the current sources and queues add/remove events
+  void sync_sources(DynamicDmap &dmap, std::vector<size_t> tiles);
+
+  // applies queued events, returns true if the map has changed
+  bool repair_dmap(DynamicDmap &dmap, const DungeonData &dd);
+};
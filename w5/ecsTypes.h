@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <cstdint>
 
 // TODO: make a lot of seprate files
 struct Position;
@@ -151,21 +152,59 @@ struct DungeonData
     size_t height;
 };
 
+// Downhill move for every tile of a dmap, stored as the move action itself
+// (EA_NOP when there is nowhere to go). 3 bits per tile, 10 tiles per word.
+struct FlowField
+{
+    static constexpr size_t bitsPerTile = 3;
+    static constexpr size_t tilesPerWord = 10;
+    static constexpr uint32_t tileMask = (1u << bitsPerTile) - 1u;
+
+    std::vector<uint32_t> words;
+
+    void reset(size_t num_tiles)
+    {
+        words.assign((num_tiles + tilesPerWord - 1) / tilesPerWord, 0u);
+    }
+
+    void set(size_t idx, int action)
+    {
+        const size_t shift = (idx % tilesPerWord) * bitsPerTile;
+        uint32_t& word = words[idx / tilesPerWord];
+        word = (word & ~(tileMask << shift)) | (uint32_t(action) << shift);
+    }
+
+    int get(size_t idx) const
+    {
+        return int((words[idx / tilesPerWord] >> ((idx % tilesPerWord) * bitsPerTile)) & tileMask);
+    }
+};
+
 struct DijkstraMapData
 {
     std::vector<float> map;
+    FlowField flow;
+    uint32_t version = 0; // bumped on every publish, lets derived maps notice changes
 };
 
 struct VisualiseMap {};
 
+// map names are resolved to entity ids once (see dmaps::make_weights),
+// so followers never look anything up by name
 struct DmapWeights
 {
     struct WtData
     {
+        uint64_t map = 0; // entity holding DijkstraMapData
         float mult = 1.f;
         float pow = 1.f;
     };
-    std::unordered_map<std::string, WtData> weights;
+    static constexpr size_t maxWeights = 4;
+    WtData weights[maxWeights];
+    size_t numWeights = 0;
+
+    const WtData* begin() const { return weights; }
+    const WtData* end() const { return weights + numWeights; }
 };
 
 struct Hive {};
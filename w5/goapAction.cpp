@@ -39,3 +39,59 @@ void goap::set_additive_action_effect(Action &act, const WorldDesc &desc, const
   act.setBitset[itf->second] = false;
 }
 
+
+// bytewise add with wraparound, carries don't cross into the next byte
+static uint64_t add_bytes(uint64_t lhs, uint64_t rhs)
+{
+  constexpr uint64_t highBits = 0x8080808080808080ull;
+  return ((lhs & ~highBits) + (rhs & ~highBits)) ^ ((lhs ^ rhs) & highBits);
+}
+
+goap::CompiledAction goap::compile_action(const Action &act)
+{
+  CompiledAction res;
+  auto setByte = [](uint64_t *words, size_t idx, int8_t val)
+  {
+    const size_t shift = (idx % sizeof(uint64_t)) * 8;
+    words[idx / sizeof(uint64_t)] |= uint64_t(uint8_t(val)) << shift;
+  };
+  for (size_t i = 0; i < act.precondition.size(); ++i)
+    if (act.precondition[i] >= 0)
+    {
+      setByte(res.precondMask, i, int8_t(-1));
+      setByte(res.precondValue, i, act.precondition[i]);
+    }
+  for (size_t i = 0; i < act.effect.size(); ++i)
+  {
+    if (!act.setBitset[i])
+      setByte(res.addDelta, i, act.effect[i]);
+    else if (act.effect[i] >= 0)
+    {
+      setByte(res.setMask, i, int8_t(-1));
+      setByte(res.setValue, i, act.effect[i]);
+    }
+  }
+  return res;
+}
+
+bool goap::is_action_valid(const CompiledAction &act, const WorldState &ws)
+{
+  uint64_t diff = 0;
+  for (size_t i = 0; i < WorldState::numWords; ++i)
+    diff |= (ws.word(i) ^ act.precondValue[i]) & act.precondMask[i];
+  return diff == 0;
+}
+
+bool goap::apply_compiled_action(const CompiledAction &act, const WorldState &from, WorldState &to)
+{
+  to = from;
+  uint64_t diff = 0;
+  for (size_t i = 0; i < WorldState::numWords; ++i)
+  {
+    const uint64_t word = from.word(i);
+    const uint64_t res = add_bytes((word & ~act.setMask[i]) | act.setValue[i], act.addDelta[i]);
+    diff |= res ^ word;
+    to.set_word(i, res);
+  }
+  return diff != 0;
+}
@@ -17,6 +17,22 @@ namespace goap
     float cost = 1.f;
   };
 
+  // Action as masks over whole WorldState words: checking and applying it takes a few 64-bit ops
+  // per word instead of a loop over every state
+  struct CompiledAction
+  {
+    uint64_t precondMask[WorldState::numWords] = {}; // 0xff in bytes with a precondition
+    uint64_t precondValue[WorldState::numWords] = {};
+    uint64_t setMask[WorldState::numWords] = {}; // 0xff in bytes the effect sets
+    uint64_t setValue[WorldState::numWords] = {};
+    uint64_t addDelta[WorldState::numWords] = {}; // additive effects, zero elsewhere
+  };
+
+  CompiledAction compile_action(const Action &act);
+  bool is_action_valid(const CompiledAction &act, const WorldState &ws);
+  // returns false if the action doesn't change anything
+  bool apply_compiled_action(const CompiledAction &act, const WorldState &from, WorldState &to);
+
   Action create_action(const char *name, const WorldDesc &desc, float cost);
   void set_action_precond(Action &act, const WorldDesc &desc, const char *st_name, int8_t val);
   void set_action_effect(Action &act, const WorldDesc &desc, const char *st_name, int8_t val);
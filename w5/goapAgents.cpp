@@ -0,0 +1,48 @@
+#include "goapAgents.h"
+#include "goapPlanCache.h"
+#include <unordered_map>
+
+static float plan_cost(const goap::Planner &planner, const std::vector<goap::PlanStep> &plan)
+{
+  float cost = 0.f;
+  for (const goap::PlanStep &step : plan)
+    cost += goap::get_action_cost(planner, step.action);
+  return cost;
+}
+
+void process_goap_agents(flecs::world &ecs)
+{
+  auto agentsQuery = ecs.query<GoapAgent>();
+
+  ecs.entity("goap_plans").insert([&](goap::PlanCache &cache)
+  {
+    // cache is looked up here, only misses go to the worker pool;
+    // nothing changes the world's structure until the plans are written back
+    std::unordered_map<const goap::Planner *, std::vector<GoapAgent *>> toPlan;
+    agentsQuery.each([&](GoapAgent &agent)
+    {
+      if (!agent.planner || goap::advance_plan(*agent.planner, agent.state, agent.goal, agent.plan))
+        return;
+      if (const goap::PlanCache::Entry *entry = goap::find_cached_plan(cache, *agent.planner, agent.state, agent.goal))
+        agent.plan = entry->plan;
+      else
+        toPlan[agent.planner].push_back(&agent);
+    });
+
+    std::vector<goap::PlanQuery> queries;
+    std::vector<std::vector<goap::PlanStep>> plans;
+    for (auto &[planner, agents] : toPlan)
+    {
+      queries.clear();
+      for (const GoapAgent *agent : agents)
+        queries.push_back({agent->state, agent->goal});
+      plans.assign(queries.size(), {});
+      goap::make_plans(*planner, queries, plans);
+      for (size_t i = 0; i < agents.size(); ++i)
+      {
+        agents[i]->plan = plans[i];
+        goap::store_plan(cache, *planner, queries[i].from, queries[i].to, std::move(plans[i]), plan_cost(*planner, agents[i]->plan));
+      }
+    }
+  });
+}
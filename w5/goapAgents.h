@@ -0,0 +1,18 @@
+#pragma once
+#include <flecs.h>
+#include <vector>
+
+#include "goapPlanner.h"
+
+// Agent planning with a planner shared by its whole type. Sensors keep `state` up to date,
+// the plan is checked every turn and only searched for again when it stops working.
+struct GoapAgent
+{
+  const goap::Planner *planner = nullptr;
+  goap::WorldState state;
+  goap::WorldState goal;
+  std::vector<goap::PlanStep> plan;
+};
+
+// advances plans of every GoapAgent, agents needing a new one are planned in parallel
+void process_goap_agents(flecs::world &ecs);
@@ -1,16 +1,18 @@
 #include "goapPlanner.h"
+#include "threadPool.h"
 #include <algorithm>
+#include <unordered_map>
 
 struct PlanNode
 {
   goap::WorldState worldState;
-  goap::WorldState prevState;
-  float prevG;
 
   float g = 0;
   float h = 0;
 
   size_t actionId;
+  size_t parent; // index in the node list
+  bool closed = false;
 };
 
 static float heuristic(const goap::WorldState &from, const goap::WorldState &to)
@@ -22,71 +24,132 @@ static float heuristic(const goap::WorldState &from, const goap::WorldState &to)
   return cost;
 }
 
-static void reconstruct_plan(PlanNode &goal_node, const std::vector<PlanNode> &closed, std::vector<goap::PlanStep> &plan)
+static void reconstruct_plan(size_t goal_node, const std::vector<PlanNode> &nodes, std::vector<goap::PlanStep> &plan)
 {
-  PlanNode &curNode = goal_node;
-  while (curNode.actionId != size_t(-1))
-  {
-    plan.push_back({curNode.actionId, curNode.worldState});
-    auto itf = std::find_if(closed.begin(), closed.end(), [&](const PlanNode &n) { return n.worldState == curNode.prevState && n.g == curNode.prevG; });
-    curNode = *itf;
-  }
+  for (size_t cur = goal_node; nodes[cur].actionId != size_t(-1); cur = nodes[cur].parent)
+    plan.push_back({nodes[cur].actionId, nodes[cur].worldState});
   std::reverse(plan.begin(), plan.end());
 }
 
+// search data reused between searches on the same thread, so steady state planning doesn't allocate
+struct PlanArena
+{
+  using OpenEntry = std::pair<float, size_t>; // (f, node), ties go to the older node
+  std::vector<PlanNode> nodes;
+  std::unordered_map<goap::WorldState, size_t, goap::WorldStateHash> nodeByState;
+  std::vector<OpenEntry> openList; // heap
+
+  void clear()
+  {
+    nodes.clear();
+    nodeByState.clear();
+    openList.clear();
+  }
+  void push_open(float f, size_t node)
+  {
+    openList.push_back({f, node});
+    std::push_heap(openList.begin(), openList.end(), std::greater<OpenEntry>());
+  }
+  OpenEntry pop_open()
+  {
+    std::pop_heap(openList.begin(), openList.end(), std::greater<OpenEntry>());
+    const OpenEntry res = openList.back();
+    openList.pop_back();
+    return res;
+  }
+};
+
 float goap::make_plan(const Planner &planner, const WorldState &from, const WorldState &to, std::vector<PlanStep> &plan)
 {
-  std::vector<PlanNode> openList = {PlanNode{from, from, -1, 0, heuristic(from, to), size_t(-1)}};
-  std::vector<PlanNode> closedList = {};
-  while (!openList.empty())
+  thread_local PlanArena arena;
+  arena.clear();
+  std::vector<PlanNode> &nodes = arena.nodes;
+  nodes.push_back(PlanNode{from, 0, heuristic(from, to), size_t(-1), size_t(-1)});
+  arena.nodeByState.emplace(from, 0);
+  // outdated entries are skipped when popped
+  arena.push_open(nodes[0].h, 0);
+  while (!arena.openList.empty())
   {
-    auto minIt = openList.begin();
-    float minF = minIt->g + minIt->h;
-    for (auto it = openList.begin(); it != openList.end(); ++it)
-      if (it->g + it->h < minF)
-      {
-        minF = it->g + it->h;
-        minIt = it;
-      }
-    PlanNode cur = *minIt;
-    openList.erase(minIt);
-    if (heuristic(cur.worldState, to) == 0) // we've reached our goal
+    const auto [minF, curIdx] = arena.pop_open();
+    if (nodes[curIdx].closed || minF != nodes[curIdx].g + nodes[curIdx].h)
+      continue;
+    if (nodes[curIdx].h == 0) // we've reached our goal
     {
-      reconstruct_plan(cur, closedList, plan);
+      reconstruct_plan(curIdx, nodes, plan);
       return minF;
     }
-    closedList.push_back(cur);
-    std::vector<size_t> transitions = find_valid_state_transitions(planner, cur.worldState);
-    //const bool firstIter = openList.empty();
+    nodes[curIdx].closed = true;
+    const WorldState cur = nodes[curIdx].worldState;
+    const float curG = nodes[curIdx].g;
+    std::vector<size_t> transitions = find_valid_state_transitions(planner, cur);
     //printf("------------\n");
     for (size_t actId : transitions)
     {
       //printf("valid action: %s\n", planner.actions[actId].name.c_str());
-      WorldState st = apply_action(planner, actId, cur.worldState);
-      const float score = cur.g + get_action_cost(planner, actId);
-      auto openIt = std::find_if(openList.begin(), openList.end(), [&](const PlanNode &n) { return st == n.worldState; });
-      auto closeIt = std::find_if(closedList.begin(), closedList.end(), [&](const PlanNode &n) { return st == n.worldState; });
-      if (openIt != openList.end() && score < openIt->g)
+      WorldState st = apply_action(planner, actId, cur);
+      const float score = curG + get_action_cost(planner, actId);
+      auto [itf, inserted] = arena.nodeByState.emplace(st, nodes.size());
+      if (inserted)
+        nodes.push_back({st, score, heuristic(st, to), actId, curIdx});
+      else if (score < nodes[itf->second].g)
       {
-        openIt->g = score;
-        openIt->prevState = cur.worldState;
-        openIt->prevG = cur.g;
-        openIt->h = heuristic(st, to);
+        // heuristic isn't consistent, so closed nodes get reopened
+        PlanNode &node = nodes[itf->second];
+        node.g = score;
+        node.actionId = actId;
+        node.parent = curIdx;
+        node.closed = false;
       }
-      if (closeIt != closedList.end() && score < closeIt->g)
-      {
-        closeIt->g = score;
-        closeIt->prevState = cur.worldState;
-        closeIt->prevG = cur.g;
-        closeIt->h = heuristic(st, to);
-      }
-      if (closeIt == closedList.end() && openIt == openList.end())
-        openList.push_back({st, cur.worldState, cur.g, score, heuristic(st, to), actId});
+      else
+        continue;
+      const PlanNode &node = nodes[itf->second];
+      arena.push_open(node.g + node.h, itf->second);
     }
   }
   return 0.f;
 }
 
+void goap::make_plans(const Planner &planner, std::span<const PlanQuery> queries, std::span<std::vector<PlanStep>> plans)
+{
+  struct QueryHash
+  {
+    size_t operator()(const PlanQuery &q) const { return size_t(q.from.hash() ^ (q.to.hash() * 0x9e3779b97f4a7c15ull)); }
+  };
+  struct QueryEq
+  {
+    bool operator()(const PlanQuery &lhs, const PlanQuery &rhs) const { return lhs.from == rhs.from && lhs.to == rhs.to; }
+  };
+  std::unordered_map<PlanQuery, size_t, QueryHash, QueryEq> firstQuery;
+  std::vector<size_t> uniqueQueries;
+  std::vector<size_t> sameAs(queries.size());
+  for (size_t i = 0; i < queries.size(); ++i)
+  {
+    auto [itf, inserted] = firstQuery.emplace(queries[i], i);
+    if (inserted)
+      uniqueQueries.push_back(i);
+    sameAs[i] = itf->second;
+  }
+
+  // a few chunks per thread so uneven searches still balance out, planner is only read from
+  ThreadPool &pool = get_worker_pool();
+  const size_t numChunks = std::min(uniqueQueries.size(), (pool.size() + 1) * 4);
+  for (size_t chunk = 0; chunk < numChunks; ++chunk)
+    pool.push([&, chunk]()
+    {
+      for (size_t i = chunk; i < uniqueQueries.size(); i += numChunks)
+      {
+        const size_t queryIdx = uniqueQueries[i];
+        plans[queryIdx].clear();
+        make_plan(planner, queries[queryIdx].from, queries[queryIdx].to, plans[queryIdx]);
+      }
+    });
+  pool.wait();
+
+  for (size_t i = 0; i < queries.size(); ++i)
+    if (sameAs[i] != i)
+      plans[i] = plans[sameAs[i]];
+}
+
 void goap::print_plan(const Planner &planner, const WorldState &init, const std::vector<PlanStep> &plan)
 {
   printf("%15s: ", "");
@@ -0,0 +1,102 @@
+#include "goapPlanCache.h"
+
+static uint64_t hash_combine(uint64_t seed, uint64_t val)
+{
+  return seed ^ (val + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+static bool reaches_goal(const goap::WorldState &ws, const goap::WorldState &to)
+{
+  for (size_t i = 0; i < to.size(); ++i)
+    if (to[i] >= 0 && ws[i] != to[i])
+      return false;
+  return true;
+}
+
+static uint64_t plan_key(const goap::Planner &planner, const goap::WorldState &from, const goap::WorldState &to)
+{
+  // number of actions is there in case the planner got more after the plans were made
+  uint64_t key = hash_combine(planner.id, planner.actions.size());
+  key = hash_combine(key, from.hash());
+  return hash_combine(key, to.hash());
+}
+
+const goap::PlanCache::Entry *goap::find_cached_plan(const PlanCache &cache, const Planner &planner,
+                                                     const WorldState &from, const WorldState &to)
+{
+  auto itf = cache.plans.find(plan_key(planner, from, to));
+  if (itf == cache.plans.end() || itf->second.plannerId != planner.id || itf->second.from != from || itf->second.to != to)
+    return nullptr;
+  return &itf->second;
+}
+
+void goap::store_plan(PlanCache &cache, const Planner &planner, const WorldState &from, const WorldState &to,
+                      std::vector<PlanStep> plan, float cost)
+{
+  if (cache.plans.size() >= cache.capacity)
+    cache.plans.clear();
+  cache.plans[plan_key(planner, from, to)] = {planner.id, from, to, std::move(plan), cost};
+}
+
+float goap::make_plan(const Planner &planner, PlanCache &cache, const WorldState &from, const WorldState &to,
+                      std::vector<PlanStep> &plan)
+{
+  if (const PlanCache::Entry *entry = find_cached_plan(cache, planner, from, to))
+  {
+    plan.insert(plan.end(), entry->plan.begin(), entry->plan.end());
+    return entry->cost;
+  }
+  std::vector<PlanStep> newPlan;
+  const float cost = make_plan(planner, from, to, newPlan);
+  plan.insert(plan.end(), newPlan.begin(), newPlan.end());
+  store_plan(cache, planner, from, to, std::move(newPlan), cost);
+  return cost;
+}
+
+bool goap::is_plan_valid(const Planner &planner, const WorldState &from, const WorldState &to,
+                         const std::vector<PlanStep> &plan)
+{
+  WorldState ws = from;
+  for (const PlanStep &step : plan)
+  {
+    if (!is_action_valid(planner.compiledActions[step.action], ws))
+      return false;
+    WorldState next;
+    apply_compiled_action(planner.compiledActions[step.action], ws, next);
+    ws = next;
+  }
+  return reaches_goal(ws, to);
+}
+
+bool goap::advance_plan(const Planner &planner, const WorldState &cur, const WorldState &to, std::vector<PlanStep> &plan)
+{
+  for (size_t i = plan.size(); i > 0; --i)
+    if (plan[i - 1].worldState == cur)
+    {
+      plan.erase(plan.begin(), plan.begin() + ptrdiff_t(i));
+      break;
+    }
+  if (!is_plan_valid(planner, cur, to, plan))
+    return false;
+  // the rest still works, but things could've changed on the way, so the steps get their new states
+  WorldState ws = cur;
+  for (PlanStep &step : plan)
+  {
+    apply_compiled_action(planner.compiledActions[step.action], ws, step.worldState);
+    ws = step.worldState;
+  }
+  return true;
+}
+
+bool goap::update_plan(const Planner &planner, PlanCache *cache, const WorldState &cur, const WorldState &to,
+                       std::vector<PlanStep> &plan)
+{
+  if (advance_plan(planner, cur, to, plan))
+    return false;
+  plan.clear();
+  if (cache)
+    make_plan(planner, *cache, cur, to, plan);
+  else
+    make_plan(planner, cur, to, plan);
+  return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+#include "goapPlanner.h"
+
+namespace goap
+{
+  // Plans shared by everyone using the same planner, agents of one type mostly start from the
+  // same few states. Not thread safe.
+  struct PlanCache
+  {
+    struct Entry
+    {
+      size_t plannerId;
+      WorldState from;
+      WorldState to;
+      std::vector<PlanStep> plan;
+      float cost;
+    };
+    std::unordered_map<uint64_t, Entry> plans; // keyed by planner, start and goal hashes
+    size_t capacity = 1024; // cleared when full
+  };
+
+  // nullptr if there's no plan for it yet
+  const PlanCache::Entry *find_cached_plan(const PlanCache &cache, const Planner &planner,
+                                           const WorldState &from, const WorldState &to);
+  void store_plan(PlanCache &cache, const Planner &planner, const WorldState &from, const WorldState &to,
+                  std::vector<PlanStep> plan, float cost);
+
+  // make_plan through the cache
+  float make_plan(const Planner &planner, PlanCache &cache, const WorldState &from, const WorldState &to,
+                  std::vector<PlanStep> &plan);
+
+  // true if every step of the plan can be done in order starting from `from` and it ends in `to`
+  bool is_plan_valid(const Planner &planner, const WorldState &from, const WorldState &to,
+                     const std::vector<PlanStep> &plan);
+
+  // Drops finished steps (those whose result `cur` already is) and refreshes the states of the rest,
+  // returns false if the rest doesn't lead from `cur` to the goal anymore.
+  bool advance_plan(const Planner &planner, const WorldState &cur, const WorldState &to, std::vector<PlanStep> &plan);
+
+  // advance_plan, searching for a new plan (through the cache if given) only when the rest doesn't
+  // work anymore. Returns true if it had to replan.
+  bool update_plan(const Planner &planner, PlanCache *cache, const WorldState &cur, const WorldState &to,
+                   std::vector<PlanStep> &plan);
+};
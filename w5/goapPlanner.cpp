@@ -1,14 +1,28 @@
 #include "goapPlanner.h"
+#include <cassert>
+#include <cstdio>
 
 goap::Planner goap::create_planner()
 {
-  return Planner();
+  static size_t nextId = 0;
+  Planner res;
+  res.id = nextId++;
+  return res;
 }
 
 void goap::add_states_to_planner(Planner &planner, const std::vector<std::string> &state_names)
 {
   for (const std::string &name : state_names)
+  {
+    if (planner.wdesc.size() >= WorldState::capacity && planner.wdesc.find(name) == planner.wdesc.end())
+    {
+      // actions touching it would silently be planned without it
+      fprintf(stderr, "goap: too many world states, '%s' doesn't fit in %zu\n", name.c_str(), WorldState::capacity);
+      assert(false);
+      continue;
+    }
     planner.wdesc.emplace(name, planner.wdesc.size());
+  }
 }
 
 
@@ -25,6 +39,7 @@ void goap::add_action_to_planner(Planner &planner, const char *name, float cost,
     set_additive_action_effect(act, planner.wdesc, st.first, int8_t(st.second));
 
   planner.actionNames.emplace(name, planner.actions.size());
+  planner.compiledActions.emplace_back(compile_action(act));
   planner.actions.emplace_back(act);
 }
 
@@ -51,28 +66,15 @@ float goap::get_action_cost(const Planner &planner, size_t act_id)
   return planner.actions[act_id].cost;
 }
 
-static bool not_eq_states(const goap::WorldState& lhs, const goap::WorldState& rhs)
-{
-  if (lhs.size() != rhs.size())
-    return true;
-  for (size_t i = 0; i < lhs.size(); ++i)
-    if (lhs[i] != rhs[i])
-      return true;
-  return false;
-}
-
 std::vector<size_t> goap::find_valid_state_transitions(const Planner &planner, const WorldState &from)
 {
   std::vector<size_t> res;
 
-  for (size_t i = 0; i < planner.actions.size(); ++i)
+  WorldState newWs;
+  for (size_t i = 0; i < planner.compiledActions.size(); ++i)
   {
-    const Action &action = planner.actions[i];
-    bool isValidAction = true;
-    for (size_t j = 0; j < action.precondition.size() && isValidAction; ++j)
-      isValidAction &= action.precondition[j] < 0 || from[j] == action.precondition[j];
-    WorldState newWs = apply_action(planner, i, from);
-    if (isValidAction && not_eq_states(newWs, from))
+    const CompiledAction &action = planner.compiledActions[i];
+    if (is_action_valid(action, from) && apply_compiled_action(action, from, newWs))
       res.emplace_back(i);
   }
   return res;
@@ -80,15 +82,8 @@ std::vector<size_t> goap::find_valid_state_transitions(const Planner &planner, c
 
 goap::WorldState goap::apply_action(const Planner &planner, size_t act, const WorldState &from)
 {
-  WorldState res = from;
-  const Action &action = planner.actions[act];
-  for (size_t i = 0; i < action.effect.size(); ++i)
-  {
-    if (!action.setBitset[i])
-      res[i] += action.effect[i];
-    else if (action.effect[i] >= 0)
-      res[i] = action.effect[i];
-  }
+  WorldState res;
+  apply_compiled_action(planner.compiledActions[act], from, res);
   return res;
 }
 
@@ -2,6 +2,7 @@
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <span>
 
 #include "goapWorldState.h"
 #include "goapAction.h"
@@ -11,8 +12,10 @@ namespace goap
 
   struct Planner
   {
+    size_t id = 0; // unique per create_planner call
     WorldDesc wdesc;
     std::vector<Action> actions;
+    std::vector<CompiledAction> compiledActions; // same order as actions
     std::unordered_map<std::string, size_t> actionNames;
   };
 
@@ -42,6 +45,15 @@ namespace goap
   };
 
   float make_plan(const Planner &planner, const WorldState &from, const WorldState &to, std::vector<PlanStep> &plan);
+
+  struct PlanQuery
+  {
+    WorldState from;
+    WorldState to;
+  };
+  // independent searches spread over the worker pool, plans[i] gets the plan for queries[i];
+  // equal queries are searched once
+  void make_plans(const Planner &planner, std::span<const PlanQuery> queries, std::span<std::vector<PlanStep>> plans);
   void print_plan(const Planner &planner, const WorldState &init, const std::vector<PlanStep> &plan);
 };
 
@@ -2,10 +2,75 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
 
 namespace goap
 {
-  using WorldState = std::vector<int8_t>;
+  // Values are stored inline so copying a state never allocates. Unused slots stay zero,
+  // so states are compared and hashed as whole 64-bit words.
+  class WorldState
+  {
+  public:
+    static constexpr size_t capacity = 32;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // planners never describe more than capacity states, see add_states_to_planner
+    void push_back(int8_t val)
+    {
+      assert(count < capacity);
+      if (count < capacity)
+        values[count++] = val;
+    }
+    void emplace_back(int8_t val) { push_back(val); }
+
+    int8_t &operator[](size_t idx) { return values[idx]; }
+    int8_t operator[](size_t idx) const { return values[idx]; }
+
+    const int8_t *begin() const { return values; }
+    const int8_t *end() const { return values + count; }
+
+    // 8 values per word, used by compiled actions
+    static constexpr size_t numWords = capacity / sizeof(uint64_t);
+
+    uint64_t word(size_t idx) const
+    {
+      uint64_t res;
+      memcpy(&res, values + idx * sizeof(uint64_t), sizeof(res));
+      return res;
+    }
+    void set_word(size_t idx, uint64_t val) { memcpy(values + idx * sizeof(uint64_t), &val, sizeof(val)); }
+
+    uint64_t hash() const
+    {
+      uint64_t res = count;
+      for (size_t i = 0; i < numWords; ++i)
+      {
+        res ^= word(i);
+        res *= 0x9e3779b97f4a7c15ull;
+        res ^= res >> 29;
+      }
+      return res;
+    }
+
+    bool operator==(const WorldState &rhs) const
+    {
+      return count == rhs.count && memcmp(values, rhs.values, sizeof(values)) == 0;
+    }
+    bool operator!=(const WorldState &rhs) const { return !(*this == rhs); }
+
+  private:
+    alignas(uint64_t) int8_t values[capacity] = {};
+    uint8_t count = 0;
+  };
+
+  struct WorldStateHash
+  {
+    size_t operator()(const WorldState &ws) const { return ws.hash(); }
+  };
+
   using WorldDesc = std::unordered_map<std::string, size_t>;
 };
-
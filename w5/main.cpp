@@ -6,6 +6,7 @@
 #include "roguelike.h"
 #include "dungeonGen.h"
 #include "goapPlanner.h"
+#include "dmapSolver.h"
 
 enum EnemyDist
 {
@@ -221,6 +222,15 @@ static void debug_looter_planner()
 }
 
 
+[[maybe_unused]] static void debug_dmap_bench()
+{
+  constexpr size_t dungWidth = 256;
+  constexpr size_t dungHeight = 256;
+  std::vector<char> tiles(dungWidth * dungHeight);
+  gen_drunk_dungeon(tiles.data(), dungWidth, dungHeight);
+  dmaps::bench_process_dmap(DungeonData{tiles, dungWidth, dungHeight}, 10);
+}
+
 static void update_camera(Camera2D &cam, flecs::world &ecs)
 {
   auto playerQuery = ecs.query<const Position, const IsPlayer>();
@@ -259,6 +269,7 @@ int main(int /*argc*/, const char ** /*argv*/)
   init_roguelike(ecs);
   //debug_enemy_planner();
   debug_looter_planner();
+  //debug_dmap_bench();
 
   Camera2D camera = { {0, 0}, {0, 0}, 0.f, 1.f };
   camera.target = Vector2{ 0.f, 0.f };
@@ -7,8 +7,10 @@
 #include "math.h"
 #include "dungeonUtils.h"
 #include "dijkstraMapGen.h"
+#include "dmapCache.h"
 #include "dmapFollower.h"
 #include "dmapBeh.h"
+#include "goapAgents.h"
 #include "rlikeObjects.h"
 
 
@@ -91,25 +93,20 @@ static void register_roguelike_systems(flecs::world& ecs)
                 auto dungeonDataQuery = ecs.query<const DungeonData>();
                 dungeonDataQuery.each([&](const DungeonData& dd)
                     {
-                        for (size_t y = 0; y < dd.height; ++y)
-                            for (size_t x = 0; x < dd.width; ++x)
+                        ecs.entity("combined_dmaps").get([&](const CombinedDmapCache& cache)
                             {
-                                float sum = 0.f;
-                                for (const auto& pair : wt.weights)
-                                {
-                                    ecs.entity(pair.first.c_str()).get([&](const DijkstraMapData& dmap)
-                                        {
-                                            float v = dmap.map[y * dd.width + x];
-                                            if (v < 1e5f)
-                                                sum += powf(v * pair.second.mult, pair.second.pow);
-                                            else
-                                                sum += v;
-                                        });
-                                }
-                                if (sum < 1e5f)
-                                    DrawText(TextFormat("%.1f", sum),
-                                        int((float(x) + 0.2f) * tile_size), int((float(y) + 0.5f) * tile_size), 150, WHITE);
-                            }
+                                const DijkstraMapData* dmap = dmaps::find_combined_dmap(cache, wt);
+                                if (!dmap || dmap->map.size() != dd.width * dd.height)
+                                    return;
+                                for (size_t y = 0; y < dd.height; ++y)
+                                    for (size_t x = 0; x < dd.width; ++x)
+                                    {
+                                        const float sum = dmap->map[y * dd.width + x];
+                                        if (sum < 1e5f)
+                                            DrawText(TextFormat("%.1f", sum),
+                                                int((float(x) + 0.2f) * tile_size), int((float(y) + 0.5f) * tile_size), 150, WHITE);
+                                    }
+                            });
                     });
             });
     ecs.system<const DijkstraMapData>()
@@ -443,6 +440,7 @@ void process_turn(flecs::world& ecs)
         {
             // Plan action for NPCs
             gather_world_info(ecs);
+            process_goap_agents(ecs);
             ecs.defer([&]
                 {
                     stateMachineAct.each([&](flecs::entity e, StateMachine& sm)
@@ -461,48 +459,12 @@ void process_turn(flecs::world& ecs)
         process_melee_damage(ecs);
 
         //   
-        std::vector<float> approachMap;
-        dmaps::gen_player_approach_map(ecs, approachMap);
-        ecs.entity("approach_map")
-            .set(DijkstraMapData{ approachMap });
-
-        std::vector<float> fleeMap;
-        dmaps::gen_player_flee_map(ecs, fleeMap);
-        ecs.entity("flee_map")
-            .set(DijkstraMapData{ fleeMap });
-
-        std::vector<float> hiveMap;
-        dmaps::gen_hive_pack_map(ecs, hiveMap);
-        ecs.entity("hive_map")
-            .set(DijkstraMapData{ hiveMap });
-
-        //     
-        std::vector<float> spawnMapKnights;
-        std::vector<float> spawnMapMonsters;
-        dmaps::gen_spawn_points_map(ecs, spawnMapKnights, 0);  // 
-        dmaps::gen_spawn_points_map(ecs, spawnMapMonsters, 1); // 
-
-        ecs.entity("spawn_map_knights").set(DijkstraMapData{ spawnMapKnights });
-        ecs.entity("spawn_map_monsters").set(DijkstraMapData{ spawnMapMonsters });
-
-        //       
-        std::vector<float> teamMapKnights;
-        std::vector<float> teamMapMonsters;
-        dmaps::gen_team_positions_map(ecs, teamMapKnights, 0);  //  
-        dmaps::gen_team_positions_map(ecs, teamMapMonsters, 1); //  
-
-        ecs.entity("team_map_knights").set(DijkstraMapData{ teamMapKnights });
-        ecs.entity("team_map_monsters").set(DijkstraMapData{ teamMapMonsters });
-
-        //     
-        std::vector<float> healMap;
-        dmaps::gen_heal_points_map(ecs, healMap);
-
-        ecs.entity("heal_map").set(DijkstraMapData{ healMap });
+        dmaps::gen_turn_maps(ecs);
+        dmaps::update_combined_dmaps(ecs);
 
         //ecs.entity("flee_map").add<VisualiseMap>();
         ecs.entity("hive_follower_sum")
-            .set(DmapWeights{ {{"hive_map", {1.f, 1.f}}, {"approach_map", {1.8f, 0.8f}}} })
+            .set(dmaps::make_weights(ecs, { {"hive_map", 1.f, 1.f}, {"approach_map", 1.8f, 0.8f} }))
             .add<VisualiseMap>();
     }
 }
@@ -0,0 +1,68 @@
+#include "threadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t num_threads)
+{
+  for (size_t i = 0; i < num_threads; ++i)
+    threads.emplace_back([this]() { worker(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobAvailable.notify_all();
+  for (std::thread &thread : threads)
+    thread.join();
+}
+
+void ThreadPool::push(std::function<void()> job)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.emplace_back(std::move(job));
+    unfinishedJobs++;
+  }
+  jobAvailable.notify_one();
+}
+
+bool ThreadPool::run_one(std::unique_lock<std::mutex> &lock)
+{
+  if (jobs.empty())
+    return false;
+  std::function<void()> job = std::move(jobs.front());
+  jobs.pop_front();
+  lock.unlock();
+  job();
+  lock.lock();
+  if (--unfinishedJobs == 0)
+    allDone.notify_all();
+  return true;
+}
+
+void ThreadPool::wait()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (run_one(lock));
+  allDone.wait(lock, [this]() { return unfinishedJobs == 0; });
+}
+
+void ThreadPool::worker()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true)
+  {
+    jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+    if (stopping && jobs.empty())
+      return;
+    run_one(lock);
+  }
+}
+
+ThreadPool &get_worker_pool()
+{
+  static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+  return pool;
+}
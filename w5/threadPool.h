@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Fixed set of worker threads consuming a shared job queue.
+// The thread calling wait() helps with the queue until it's empty.
+class ThreadPool
+{
+public:
+  explicit ThreadPool(size_t num_threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void push(std::function<void()> job);
+  // blocks until every pushed job has finished
+  void wait();
+
+  size_t size() const { return threads.size(); }
+
+private:
+  bool run_one(std::unique_lock<std::mutex> &lock);
+  void worker();
+
+  std::vector<std::thread> threads;
+  std::deque<std::function<void()>> jobs;
+  size_t unfinishedJobs = 0;
+  bool stopping = false;
+
+  std::mutex mutex;
+  std::condition_variable jobAvailable;
+  std::condition_variable allDone;
+};
+
+// shared pool for per-turn work, one worker less than the core count as the main thread joins in wait()
+ThreadPool &get_worker_pool();
@@ -5,6 +5,7 @@
 #include "ecsTypes.h"
 #include "shootEmUp.h"
 #include "dungeonGen.h"
+#include "pathfinder.h"
 
 static void update_camera(flecs::world &ecs)
 {
@@ -22,6 +23,15 @@ static void update_camera(flecs::world &ecs)
   });
 }
 
+[[maybe_unused]] static void debug_path_bench()
+{
+  for (size_t size : {size_t(100), size_t(200), size_t(400)})
+  {
+    std::vector<char> tiles(size * size);
+    gen_drunk_dungeon(tiles.data(), size, size);
+    bench_find_path(DungeonData{tiles, size, size}, 200);
+  }
+}
 
 int main(int /*argc*/, const char ** /*argv*/)
 {
@@ -47,6 +57,7 @@ int main(int /*argc*/, const char ** /*argv*/)
     init_dungeon(ecs, tiles, dungWidth, dungHeight);
   }
   init_shoot_em_up(ecs);
+  //debug_path_bench();
 
   Camera2D camera = { {0, 0}, {0, 0}, 0.f, 1.f };
   camera.target = Vector2{ 0.f, 0.f };
@@ -0,0 +1,157 @@
+#include "pathRequests.h"
+#include "pathfinder.h"
+#include "dungeonUtils.h"
+#include "threadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+struct PendingRequest
+{
+  flecs::entity e;
+  PathRequest req;
+};
+
+// all pending requests to one goal
+struct RequestGroup
+{
+  IVec2 to;
+  std::vector<PendingRequest> requests;
+  std::vector<std::vector<IVec2>> paths;
+};
+
+// one backward BFS from the goal, stops as soon as every start is reached
+static void find_paths_to_goal(const DungeonData &dd, RequestGroup &group)
+{
+  auto isWalkable = [&](IVec2 p)
+  {
+    return p.x >= 0 && p.y >= 0 && p.x < int(dd.width) && p.y < int(dd.height) &&
+           dd.tiles[size_t(p.y) * dd.width + size_t(p.x)] != dungeon::wall;
+  };
+  group.paths.assign(group.requests.size(), std::vector<IVec2>());
+  if (!isWalkable(group.to))
+    return;
+
+  constexpr size_t unreached = ~size_t(0);
+  std::vector<size_t> next(dd.width * dd.height, unreached); // step towards the goal
+  std::vector<bool> isStart(dd.width * dd.height, false);
+  size_t startsLeft = 0;
+  for (const PendingRequest &pr : group.requests)
+  {
+    if (!isWalkable(pr.req.from))
+      continue;
+    const size_t idx = size_t(pr.req.from.y) * dd.width + size_t(pr.req.from.x);
+    startsLeft += !isStart[idx];
+    isStart[idx] = true;
+  }
+
+  const size_t goalIdx = size_t(group.to.y) * dd.width + size_t(group.to.x);
+  std::vector<size_t> front = {goalIdx};
+  next[goalIdx] = goalIdx;
+  startsLeft -= isStart[goalIdx];
+  for (size_t i = 0; i < front.size() && startsLeft > 0; ++i)
+  {
+    const size_t idx = front[i];
+    const IVec2 p{int(idx % dd.width), int(idx / dd.width)};
+    for (IVec2 n : {IVec2{p.x + 1, p.y}, IVec2{p.x - 1, p.y}, IVec2{p.x, p.y + 1}, IVec2{p.x, p.y - 1}})
+    {
+      if (!isWalkable(n))
+        continue;
+      const size_t nidx = size_t(n.y) * dd.width + size_t(n.x);
+      if (next[nidx] != unreached)
+        continue;
+      next[nidx] = idx;
+      startsLeft -= isStart[nidx];
+      front.push_back(nidx);
+    }
+  }
+
+  for (size_t i = 0; i < group.requests.size(); ++i)
+  {
+    const IVec2 from = group.requests[i].req.from;
+    if (!isWalkable(from) || next[size_t(from.y) * dd.width + size_t(from.x)] == unreached)
+      continue;
+    std::vector<IVec2> &path = group.paths[i];
+    size_t idx = size_t(from.y) * dd.width + size_t(from.x);
+    path.push_back(from);
+    while (idx != goalIdx)
+    {
+      idx = next[idx];
+      path.push_back(IVec2{int(idx % dd.width), int(idx / dd.width)});
+    }
+  }
+}
+
+static void serve_group(const DungeonData &dd, const DungeonPortals &dp, RequestGroup &group)
+{
+  // a single request is cheaper through the portal graph
+  if (group.requests.size() == 1)
+    group.paths = {find_path(dd, dp, group.requests[0].req.from, group.to)};
+  else
+    find_paths_to_goal(dd, group);
+}
+
+void paths::process_requests(flecs::world &ecs, double budget_ms)
+{
+  const auto startTime = std::chrono::steady_clock::now();
+  auto requestQuery = ecs.query<const PathRequest>();
+  auto dungeonQuery = ecs.query<const DungeonData, const DungeonPortals>();
+
+  std::vector<PendingRequest> pending;
+  requestQuery.each([&](flecs::entity e, const PathRequest &req) { pending.push_back({e, req}); });
+  if (pending.empty())
+    return;
+  std::stable_sort(pending.begin(), pending.end(), [](const PendingRequest &lhs, const PendingRequest &rhs)
+  {
+    if (lhs.req.priority != rhs.req.priority)
+      return lhs.req.priority > rhs.req.priority;
+    return lhs.req.framesWaited > rhs.req.framesWaited;
+  });
+
+  // groups keep the order of their most urgent request
+  std::vector<RequestGroup> groups;
+  std::unordered_map<uint64_t, size_t> groupByGoal;
+  for (const PendingRequest &pr : pending)
+  {
+    const uint64_t key = (uint64_t(uint32_t(pr.req.to.x)) << 32) | uint32_t(pr.req.to.y);
+    auto itf = groupByGoal.find(key);
+    if (itf == groupByGoal.end())
+    {
+      itf = groupByGoal.emplace(key, groups.size()).first;
+      groups.push_back({pr.req.to, {}, {}});
+    }
+    groups[itf->second].requests.push_back(pr);
+  }
+
+  size_t numServed = 0;
+  dungeonQuery.each([&](const DungeonData &dd, const DungeonPortals &dp)
+  {
+    // the main thread blocks in wait(), so a batch is as many groups as there are threads
+    ThreadPool &pool = get_worker_pool();
+    const size_t batchSize = pool.size() + 1;
+    while (numServed < groups.size())
+    {
+      const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+      if (elapsed.count() >= budget_ms)
+        break;
+      const size_t batchEnd = std::min(groups.size(), numServed + batchSize);
+      for (size_t i = numServed; i < batchEnd; ++i)
+        pool.push([&dd, &dp, &group = groups[i]]() { serve_group(dd, dp, group); });
+      pool.wait();
+      numServed = batchEnd;
+    }
+  });
+
+  for (size_t i = 0; i < groups.size(); ++i)
+    for (size_t j = 0; j < groups[i].requests.size(); ++j)
+    {
+      flecs::entity e = groups[i].requests[j].e;
+      if (i < numServed)
+      {
+        e.set(PathResult{groups[i].to, std::move(groups[i].paths[j])});
+        e.remove<PathRequest>();
+      }
+      else
+        e.insert([](PathRequest &req) { req.framesWaited++; });
+    }
+}
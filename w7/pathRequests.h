@@ -0,0 +1,26 @@
+#pragma once
+#include <flecs.h>
+#include <vector>
+#include "math.h"
+
+// set on an agent to ask for a path, gets replaced with PathResult once it's served
+struct PathRequest
+{
+  IVec2 from;
+  IVec2 to;
+  int priority = 0; // higher goes first
+  size_t framesWaited = 0; // ties between equal priorities go to the older request
+};
+
+struct PathResult
+{
+  IVec2 to;
+  std::vector<IVec2> path; // from `from` to `to` inclusive, empty if there's no path
+};
+
+namespace paths
+{
+  // Serves pending PathRequests on the worker pool in priority order, requests to the same goal
+  // share one search. Stops taking new batches once budget_ms is spent, the rest waits for next frames.
+  void process_requests(flecs::world &ecs, double budget_ms);
+};
@@ -1,7 +1,12 @@
 #include "pathfinder.h"
 #include "dungeonUtils.h"
 #include "math.h"
+#include "indexedHeap.h"
+#include "threadPool.h"
+#include "raylib.h"
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
 
 float heuristic(IVec2 lhs, IVec2 rhs)
 {
@@ -14,79 +19,69 @@ static size_t coord_to_idx(T x, T y, size_t w)
   return size_t(y) * w + size_t(x);
 }
 
-static std::vector<IVec2> reconstruct_path(std::vector<IVec2> prev, IVec2 to, size_t width)
+// prev is indexed within the search box starting at lim_min
+static std::vector<IVec2> reconstruct_path(const std::vector<IVec2> &prev, IVec2 to, IVec2 lim_min, size_t width)
 {
+  auto prevAt = [&](IVec2 p) { return prev[coord_to_idx(p.x - lim_min.x, p.y - lim_min.y, width)]; };
   IVec2 curPos = to;
   std::vector<IVec2> res = {curPos};
-  while (prev[coord_to_idx(curPos.x, curPos.y, width)] != IVec2{-1, -1})
+  while (prevAt(curPos) != IVec2{-1, -1})
   {
-    curPos = prev[coord_to_idx(curPos.x, curPos.y, width)];
-    res.insert(res.begin(), curPos);
+    curPos = prevAt(curPos);
+    res.push_back(curPos);
   }
+  std::reverse(res.begin(), res.end());
   return res;
 }
 
+// search state only covers the [lim_min, lim_max) box, so local searches stay cheap on big levels
 static std::vector<IVec2> find_path_a_star(const DungeonData &dd, IVec2 from, IVec2 to,
                                            IVec2 lim_min, IVec2 lim_max)
 {
-  if (from.x < 0 || from.y < 0 || from.x >= int(dd.width) || from.y >= int(dd.height))
+  lim_min = IVec2{std::max(lim_min.x, 0), std::max(lim_min.y, 0)};
+  lim_max = IVec2{std::min(lim_max.x, int(dd.width)), std::min(lim_max.y, int(dd.height))};
+  if (from.x < lim_min.x || from.y < lim_min.y || from.x >= lim_max.x || from.y >= lim_max.y)
     return std::vector<IVec2>();
-  size_t inpSize = dd.width * dd.height;
+  const size_t boxWidth = size_t(lim_max.x - lim_min.x);
+  const size_t inpSize = boxWidth * size_t(lim_max.y - lim_min.y);
+  auto boxIdx = [&](IVec2 p) { return coord_to_idx(p.x - lim_min.x, p.y - lim_min.y, boxWidth); };
 
   std::vector<float> g(inpSize, std::numeric_limits<float>::max());
-  std::vector<float> f(inpSize, std::numeric_limits<float>::max());
   std::vector<IVec2> prev(inpSize, {-1,-1});
+  std::vector<bool> closed(inpSize, false);
+  IndexedHeap openList;
+  openList.reset(inpSize);
 
-  auto getG = [&](IVec2 p) -> float { return g[coord_to_idx(p.x, p.y, dd.width)]; };
-  auto getF = [&](IVec2 p) -> float { return f[coord_to_idx(p.x, p.y, dd.width)]; };
-
-  g[coord_to_idx(from.x, from.y, dd.width)] = 0;
-  f[coord_to_idx(from.x, from.y, dd.width)] = heuristic(from, to);
-
-  std::vector<IVec2> openList = {from};
-  std::vector<IVec2> closedList;
+  const size_t fromIdx = boxIdx(from);
+  g[fromIdx] = 0;
+  openList.push(fromIdx, heuristic(from, to));
 
   while (!openList.empty())
   {
-    size_t bestIdx = 0;
-    float bestScore = getF(openList[0]);
-    for (size_t i = 1; i < openList.size(); ++i)
-    {
-      float score = getF(openList[i]);
-      if (score < bestScore)
-      {
-        bestIdx = i;
-        bestScore = score;
-      }
-    }
-    if (openList[bestIdx] == to)
-      return reconstruct_path(prev, to, dd.width);
-    IVec2 curPos = openList[bestIdx];
-    openList.erase(openList.begin() + bestIdx);
-    if (std::find(closedList.begin(), closedList.end(), curPos) != closedList.end())
-      continue;
-    size_t idx = coord_to_idx(curPos.x, curPos.y, dd.width);
-    closedList.emplace_back(curPos);
+    const size_t idx = openList.pop();
+    const IVec2 curPos{lim_min.x + int(idx % boxWidth), lim_min.y + int(idx / boxWidth)};
+    if (curPos == to)
+      return reconstruct_path(prev, to, lim_min, boxWidth);
+    closed[idx] = true;
     auto checkNeighbour = [&](IVec2 p)
     {
       // out of bounds
       if (p.x < lim_min.x || p.y < lim_min.y || p.x >= lim_max.x || p.y >= lim_max.y)
         return;
-      size_t idx = coord_to_idx(p.x, p.y, dd.width);
+      size_t nidx = boxIdx(p);
       // not empty
-      if (dd.tiles[idx] == dungeon::wall)
+      if (dd.tiles[coord_to_idx(p.x, p.y, dd.width)] == dungeon::wall)
         return;
       float edgeWeight = 1.f;
-      float gScore = getG(curPos) + 1.f * edgeWeight; // we're exactly 1 unit away
-      if (gScore < getG(p))
+      float gScore = g[idx] + 1.f * edgeWeight; // we're exactly 1 unit away
+      if (gScore < g[nidx])
       {
-        prev[idx] = curPos;
-        g[idx] = gScore;
-        f[idx] = gScore + heuristic(p, to);
+        // closed nodes still take the better parent, they just aren't expanded again
+        prev[nidx] = curPos;
+        g[nidx] = gScore;
+        if (!closed[nidx])
+          openList.push(nidx, gScore + heuristic(p, to));
       }
-      bool found = std::find(openList.begin(), openList.end(), p) != openList.end();
-      if (!found)
-        openList.emplace_back(p);
     };
     checkNeighbour({curPos.x + 1, curPos.y + 0});
     checkNeighbour({curPos.x - 1, curPos.y + 0});
@@ -98,6 +93,294 @@ static std::vector<IVec2> find_path_a_star(const DungeonData &dd, IVec2 from, IV
 }
 
 
+static size_t super_tile_idx(const DungeonData &dd, const DungeonPortals &dp, IVec2 p)
+{
+  return size_t(p.y) / dp.tileSplit * (dd.width / dp.tileSplit) + size_t(p.x) / dp.tileSplit;
+}
+
+static void super_tile_limits(const DungeonData &dd, const DungeonPortals &dp, size_t tidx,
+                              IVec2 &lim_min, IVec2 &lim_max)
+{
+  const size_t width = dd.width / dp.tileSplit;
+  lim_min = IVec2{int(tidx % width * dp.tileSplit), int(tidx / width * dp.tileSplit)};
+  lim_max = IVec2{lim_min.x + int(dp.tileSplit), lim_min.y + int(dp.tileSplit)};
+}
+
+// spans of walkable tile pairs along the border of super tile (xx, yy) and its neighbour at offs
+static void find_border_portals(const DungeonData &dd, size_t split_tiles, size_t xx, size_t yy,
+                                size_t dir_x, size_t dir_y, int offs_x, int offs_y,
+                                std::vector<PathPortal> &portals)
+{
+  int spanFrom = -1;
+  int spanTo = -1;
+  for (size_t i = 0; i < split_tiles; ++i)
+  {
+    size_t x = xx * split_tiles + i * dir_x;
+    size_t y = yy * split_tiles + i * dir_y;
+    size_t nx = x + offs_x;
+    size_t ny = y + offs_y;
+    if (dd.tiles[y * dd.width + x] != dungeon::wall &&
+        dd.tiles[ny * dd.width + nx] != dungeon::wall)
+    {
+      if (spanFrom < 0)
+        spanFrom = i;
+      spanTo = i;
+    }
+    else if (spanFrom >= 0)
+    {
+      // write span
+      portals.push_back({xx * split_tiles + spanFrom * dir_x + offs_x,
+                         yy * split_tiles + spanFrom * dir_y + offs_y,
+                         xx * split_tiles + spanTo * dir_x,
+                         yy * split_tiles + spanTo * dir_y});
+      spanFrom = -1;
+    }
+  }
+  if (spanFrom >= 0)
+  {
+    portals.push_back({xx * split_tiles + spanFrom * dir_x + offs_x,
+                       yy * split_tiles + spanFrom * dir_y + offs_y,
+                       xx * split_tiles + spanTo * dir_x,
+                       yy * split_tiles + spanTo * dir_y});
+  }
+}
+
+// border between super tile (x, y) and its top (0, -1) or left (-1, 0) neighbour
+static std::vector<PathPortal> find_border_portals(const DungeonData &dd, const DungeonPortals &dp,
+                                                   size_t x, size_t y, int offs_x, int offs_y)
+{
+  std::vector<PathPortal> portals;
+  find_border_portals(dd, dp.tileSplit, x, y, offs_x == 0 ? 1 : 0, offs_y == 0 ? 1 : 0, offs_x, offs_y, portals);
+  return portals;
+}
+
+// portal start lies in the top/left super tile of the border, end in the other one
+static void portal_super_tiles(const DungeonData &dd, const DungeonPortals &dp, const PathPortal &portal,
+                               size_t &first, size_t &second)
+{
+  first = super_tile_idx(dd, dp, IVec2{int(portal.startX), int(portal.startY)});
+  second = super_tile_idx(dd, dp, IVec2{int(portal.endX), int(portal.endY)});
+}
+
+static void add_portal(const DungeonData &dd, DungeonPortals &dp, const PathPortal &portal)
+{
+  size_t first, second;
+  portal_super_tiles(dd, dp, portal, first, second);
+  const size_t idx = dp.portals.size();
+  dp.portals.push_back(portal);
+  dp.tilePortalsIndices[second].push_back(idx);
+  dp.tilePortalsIndices[first].push_back(idx);
+}
+
+// the last portal takes the freed slot so indices stay dense
+static void remove_portal(const DungeonData &dd, DungeonPortals &dp, size_t idx)
+{
+  auto forEachNeighbourPortal = [&](size_t portal_idx, auto c)
+  {
+    size_t tiles[2];
+    portal_super_tiles(dd, dp, dp.portals[portal_idx], tiles[0], tiles[1]);
+    for (size_t tidx : tiles)
+      c(dp.tilePortalsIndices[tidx]);
+  };
+  forEachNeighbourPortal(idx, [&](std::vector<size_t> &indices)
+  {
+    indices.erase(std::remove(indices.begin(), indices.end(), idx), indices.end());
+    for (size_t other : indices)
+    {
+      std::vector<PortalConnection> &conns = dp.portals[other].conns;
+      conns.erase(std::remove_if(conns.begin(), conns.end(),
+                                 [&](const PortalConnection &conn) { return conn.connIdx == idx; }),
+                  conns.end());
+    }
+  });
+  const size_t last = dp.portals.size() - 1;
+  if (idx != last)
+  {
+    forEachNeighbourPortal(last, [&](std::vector<size_t> &indices)
+    {
+      std::replace(indices.begin(), indices.end(), last, idx);
+      for (size_t other : indices)
+        for (PortalConnection &conn : dp.portals[other].conns)
+          if (conn.connIdx == last)
+            conn.connIdx = idx;
+    });
+    dp.portals[idx] = std::move(dp.portals[last]);
+  }
+  dp.portals.pop_back();
+}
+
+using SuperTileConns = std::vector<std::pair<size_t, PortalConnection>>; // (portal, its connection)
+
+// One BFS per portal over the super tile gives its distance to every other portal there.
+// Score is the tile count of the shortest path between the closest portal tiles.
+static void build_super_tile_conns(const DungeonData &dd, const DungeonPortals &dp, size_t tidx,
+                                   SuperTileConns &conns)
+{
+  IVec2 limMin, limMax;
+  super_tile_limits(dd, dp, tidx, limMin, limMax);
+  const size_t split = dp.tileSplit;
+  auto localIdx = [&](IVec2 p) { return coord_to_idx(p.x - limMin.x, p.y - limMin.y, split); };
+  auto forEachPortalTile = [&](const PathPortal &portal, auto c)
+  {
+    for (int y = std::max(int(portal.startY), limMin.y); y <= std::min(int(portal.endY), limMax.y - 1); ++y)
+      for (int x = std::max(int(portal.startX), limMin.x); x <= std::min(int(portal.endX), limMax.x - 1); ++x)
+        c(IVec2{x, y});
+  };
+
+  constexpr uint32_t unreachable = ~0u;
+  std::vector<uint32_t> dist;
+  std::vector<IVec2> queue;
+  const std::vector<size_t> &indices = dp.tilePortalsIndices[tidx];
+  for (size_t i = 0; i < indices.size(); ++i)
+  {
+    dist.assign(split * split, unreachable);
+    queue.clear();
+    forEachPortalTile(dp.portals[indices[i]], [&](IVec2 p)
+    {
+      dist[localIdx(p)] = 0;
+      queue.push_back(p);
+    });
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+      const IVec2 cur = queue[head];
+      const uint32_t nextDist = dist[localIdx(cur)] + 1;
+      auto checkNeighbour = [&](IVec2 p)
+      {
+        if (p.x < limMin.x || p.y < limMin.y || p.x >= limMax.x || p.y >= limMax.y)
+          return;
+        if (dd.tiles[coord_to_idx(p.x, p.y, dd.width)] == dungeon::wall || dist[localIdx(p)] != unreachable)
+          return;
+        dist[localIdx(p)] = nextDist;
+        queue.push_back(p);
+      };
+      checkNeighbour({cur.x + 1, cur.y + 0});
+      checkNeighbour({cur.x - 1, cur.y + 0});
+      checkNeighbour({cur.x + 0, cur.y + 1});
+      checkNeighbour({cur.x + 0, cur.y - 1});
+    }
+    for (size_t j = 0; j < indices.size(); ++j)
+    {
+      if (j == i)
+        continue;
+      uint32_t minDist = unreachable;
+      forEachPortalTile(dp.portals[indices[j]], [&](IVec2 p) { minDist = std::min(minDist, dist[localIdx(p)]); });
+      if (minDist != unreachable)
+        conns.push_back({indices[i], PortalConnection{indices[j], float(minDist + 1), tidx}});
+    }
+  }
+}
+
+// super tiles only read the portals, so each is a separate job writing to its own list
+static void build_conns(const DungeonData &dd, DungeonPortals &dp, const std::vector<size_t> &tiles)
+{
+  std::vector<SuperTileConns> conns(tiles.size());
+  ThreadPool &pool = get_worker_pool();
+  for (size_t i = 0; i < tiles.size(); ++i)
+    pool.push([&, i]() { build_super_tile_conns(dd, dp, tiles[i], conns[i]); });
+  pool.wait();
+  for (const SuperTileConns &tileConns : conns)
+    for (const auto &conn : tileConns)
+      dp.portals[conn.first].conns.push_back(conn.second);
+}
+
+static DungeonPortals build_portals(const DungeonData &dd, size_t split_tiles)
+{
+  // go through each super tile
+  const size_t width = dd.width / split_tiles;
+  const size_t height = dd.height / split_tiles;
+  DungeonPortals dp{split_tiles, {}, std::vector<std::vector<size_t>>(width * height)};
+  for (size_t y = 0; y < height; ++y)
+    for (size_t x = 0; x < width; ++x)
+    {
+      // check top
+      if (y > 0)
+        for (const PathPortal &portal : find_border_portals(dd, dp, x, y, 0, -1))
+          add_portal(dd, dp, portal);
+      // left
+      if (x > 0)
+        for (const PathPortal &portal : find_border_portals(dd, dp, x, y, -1, 0))
+          add_portal(dd, dp, portal);
+    }
+  std::vector<size_t> tiles(width * height);
+  for (size_t tidx = 0; tidx < tiles.size(); ++tidx)
+    tiles[tidx] = tidx;
+  build_conns(dd, dp, tiles);
+  return dp;
+}
+
+static void rebuild_cluster(const DungeonData &dd, DungeonPortals &dp, size_t x, size_t y)
+{
+  const size_t width = dd.width / dp.tileSplit;
+  const size_t height = dd.height / dp.tileSplit;
+  const size_t cx = x / dp.tileSplit;
+  const size_t cy = y / dp.tileSplit;
+  if (cx >= width || cy >= height)
+    return;
+
+  // each border as the super tile below/right of it and the offset to the other one
+  struct Border
+  {
+    size_t x, y;
+    int offsX, offsY;
+  };
+  std::vector<Border> borders;
+  if (cy > 0)
+    borders.push_back({cx, cy, 0, -1});
+  if (cx > 0)
+    borders.push_back({cx, cy, -1, 0});
+  if (cy + 1 < height)
+    borders.push_back({cx, cy + 1, 0, -1});
+  if (cx + 1 < width)
+    borders.push_back({cx + 1, cy, -1, 0});
+
+  std::vector<size_t> dirtyTiles = {cy * width + cx};
+  for (const Border &border : borders)
+  {
+    const size_t first = (border.y + border.offsY) * width + border.x + border.offsX;
+    const size_t second = border.y * width + border.x;
+    auto findOldPortal = [&]() -> size_t
+    {
+      for (size_t idx : dp.tilePortalsIndices[second])
+        if (std::find(dp.tilePortalsIndices[first].begin(), dp.tilePortalsIndices[first].end(), idx) !=
+            dp.tilePortalsIndices[first].end())
+          return idx;
+      return dp.portals.size();
+    };
+    auto samePortal = [](const PathPortal &lhs, const PathPortal &rhs)
+    {
+      return lhs.startX == rhs.startX && lhs.startY == rhs.startY && lhs.endX == rhs.endX && lhs.endY == rhs.endY;
+    };
+    const std::vector<PathPortal> newPortals = find_border_portals(dd, dp, border.x, border.y, border.offsX, border.offsY);
+    size_t numOld = 0;
+    bool unchanged = true;
+    for (size_t idx : dp.tilePortalsIndices[second])
+      if (std::find(dp.tilePortalsIndices[first].begin(), dp.tilePortalsIndices[first].end(), idx) !=
+          dp.tilePortalsIndices[first].end())
+      {
+        numOld++;
+        unchanged &= std::any_of(newPortals.begin(), newPortals.end(),
+                                 [&](const PathPortal &portal) { return samePortal(portal, dp.portals[idx]); });
+      }
+    if (unchanged && numOld == newPortals.size())
+      continue;
+    for (size_t idx = findOldPortal(); idx < dp.portals.size(); idx = findOldPortal())
+      remove_portal(dd, dp, idx);
+    for (const PathPortal &portal : newPortals)
+      add_portal(dd, dp, portal);
+    dirtyTiles.push_back(first == dirtyTiles[0] ? second : first);
+  }
+
+  for (size_t tidx : dirtyTiles)
+    for (size_t idx : dp.tilePortalsIndices[tidx])
+    {
+      std::vector<PortalConnection> &conns = dp.portals[idx].conns;
+      conns.erase(std::remove_if(conns.begin(), conns.end(),
+                                 [&](const PortalConnection &conn) { return conn.tileIdx == tidx; }),
+                  conns.end());
+    }
+  build_conns(dd, dp, dirtyTiles);
+}
+
 void prebuild_map(flecs::world &ecs)
 {
   auto mapQuery = ecs.query<const DungeonData>();
@@ -107,135 +390,211 @@ void prebuild_map(flecs::world &ecs)
   {
     mapQuery.each([&](flecs::entity e, const DungeonData &dd)
     {
-      // go through each super tile
-      const size_t width = dd.width / splitTiles;
-      const size_t height = dd.height / splitTiles;
-
-      auto check_border = [&](size_t xx, size_t yy,
-                              size_t dir_x, size_t dir_y,
-                              int offs_x, int offs_y,
-                              std::vector<PathPortal> &portals)
-      {
-        int spanFrom = -1;
-        int spanTo = -1;
-        for (size_t i = 0; i < splitTiles; ++i)
-        {
-          size_t x = xx * splitTiles + i * dir_x;
-          size_t y = yy * splitTiles + i * dir_y;
-          size_t nx = x + offs_x;
-          size_t ny = y + offs_y;
-          if (dd.tiles[y * dd.width + x] != dungeon::wall &&
-              dd.tiles[ny * dd.width + nx] != dungeon::wall)
-          {
-            if (spanFrom < 0)
-              spanFrom = i;
-            spanTo = i;
-          }
-          else if (spanFrom >= 0)
-          {
-            // write span
-            portals.push_back({xx * splitTiles + spanFrom * dir_x + offs_x,
-                               yy * splitTiles + spanFrom * dir_y + offs_y,
-                               xx * splitTiles + spanTo * dir_x,
-                               yy * splitTiles + spanTo * dir_y});
-            spanFrom = -1;
-          }
-        }
-        if (spanFrom >= 0)
-        {
-          portals.push_back({xx * splitTiles + spanFrom * dir_x + offs_x,
-                             yy * splitTiles + spanFrom * dir_y + offs_y,
-                             xx * splitTiles + spanTo * dir_x,
-                             yy * splitTiles + spanTo * dir_y});
-        }
-      };
+      e.set(build_portals(dd, splitTiles));
+    });
+  });
+}
 
-      std::vector<PathPortal> portals;
-      std::vector<std::vector<size_t>> tilePortalsIndices;
+// local A* inside the super tile to the closest tile of the portal's part in it,
+// portal tiles on one side are a straight run of floor so they are all reachable or none is
+static std::vector<IVec2> find_path_to_portal(const DungeonData &dd, const DungeonPortals &dp,
+                                              IVec2 from, size_t portal_idx, size_t tidx)
+{
+  IVec2 limMin, limMax;
+  super_tile_limits(dd, dp, tidx, limMin, limMax);
+  const PathPortal &portal = dp.portals[portal_idx];
+  const int minX = std::max(int(portal.startX), limMin.x);
+  const int maxX = std::min(int(portal.endX), limMax.x - 1);
+  const int minY = std::max(int(portal.startY), limMin.y);
+  const int maxY = std::min(int(portal.endY), limMax.y - 1);
+  const IVec2 target{std::clamp(from.x, minX, maxX), std::clamp(from.y, minY, maxY)};
+  return find_path_a_star(dd, from, target, limMin, limMax);
+}
 
-      auto push_portals = [&](size_t x, size_t y,
-                              int offs_x, int offs_y,
-                              const std::vector<PathPortal> &new_portals)
-      {
-        for (const PathPortal &portal : new_portals)
-        {
-          size_t idx = portals.size();
-          portals.push_back(portal);
-          tilePortalsIndices[y * width + x].push_back(idx);
-          tilePortalsIndices[(y + offs_y) * width + x + offs_x].push_back(idx);
-        }
-      };
-      for (size_t y = 0; y < height; ++y)
-        for (size_t x = 0; x < width; ++x)
-        {
-          tilePortalsIndices.push_back(std::vector<size_t>{});
-          // check top
-          if (y > 0)
-          {
-            std::vector<PathPortal> topPortals;
-            check_border(x, y, 1, 0, 0, -1, topPortals);
-            push_portals(x, y, 0, -1, topPortals);
-          }
-          // left
-          if (x > 0)
-          {
-            std::vector<PathPortal> leftPortals;
-            check_border(x, y, 0, 1, -1, 0, leftPortals);
-            push_portals(x, y, -1, 0, leftPortals);
-          }
-        }
-      for (size_t tidx = 0; tidx < tilePortalsIndices.size(); ++tidx)
-      {
-        const std::vector<size_t> &indices = tilePortalsIndices[tidx];
-        size_t x = tidx % width;
-        size_t y = tidx / width;
-        IVec2 limMin{int((x + 0) * splitTiles), int((y + 0) * splitTiles)};
-        IVec2 limMax{int((x + 1) * splitTiles), int((y + 1) * splitTiles)};
-        for (size_t i = 0; i < indices.size(); ++i)
+static float portal_heuristic(const PathPortal &portal, IVec2 to)
+{
+  const float cx = float(portal.startX + portal.endX) * 0.5f;
+  const float cy = float(portal.startY + portal.endY) * 0.5f;
+  return sqrtf(sqr(cx - float(to.x)) + sqr(cy - float(to.y)));
+}
+
+std::vector<IVec2> find_path(const DungeonData &dd, const DungeonPortals &dp, IVec2 from, IVec2 to)
+{
+  auto isWalkable = [&](IVec2 p)
+  {
+    return p.x >= 0 && p.y >= 0 && p.x < int(dd.width) && p.y < int(dd.height) &&
+           dd.tiles[coord_to_idx(p.x, p.y, dd.width)] != dungeon::wall;
+  };
+  if (!isWalkable(from) || !isWalkable(to))
+    return std::vector<IVec2>();
+  const IVec2 levelMin{0, 0};
+  const IVec2 levelMax{int(dd.width), int(dd.height)};
+  // leftover tiles past the last whole super tile have no portals
+  const int coveredX = int(dd.width / dp.tileSplit * dp.tileSplit);
+  const int coveredY = int(dd.height / dp.tileSplit * dp.tileSplit);
+  if (from.x >= coveredX || from.y >= coveredY || to.x >= coveredX || to.y >= coveredY)
+    return find_path_a_star(dd, from, to, levelMin, levelMax);
+
+  const size_t fromTile = super_tile_idx(dd, dp, from);
+  const size_t toTile = super_tile_idx(dd, dp, to);
+  if (fromTile == toTile)
+  {
+    IVec2 limMin, limMax;
+    super_tile_limits(dd, dp, fromTile, limMin, limMax);
+    std::vector<IVec2> path = find_path_a_star(dd, from, to, limMin, limMax);
+    if (!path.empty())
+      return path;
+  }
+
+  // start and goal become two extra nodes of the portal graph for this query only
+  const size_t numPortals = dp.portals.size();
+  const size_t startNode = numPortals;
+  const size_t goalNode = numPortals + 1;
+  std::vector<PortalConnection> startConns;
+  for (size_t portalIdx : dp.tilePortalsIndices[fromTile])
+  {
+    std::vector<IVec2> path = find_path_to_portal(dd, dp, from, portalIdx, fromTile);
+    if (!path.empty())
+      startConns.push_back({portalIdx, float(path.size()), fromTile});
+  }
+  std::vector<PortalConnection> goalConns; // connIdx is the portal leading to the goal
+  for (size_t portalIdx : dp.tilePortalsIndices[toTile])
+  {
+    std::vector<IVec2> path = find_path_to_portal(dd, dp, to, portalIdx, toTile);
+    if (!path.empty())
+      goalConns.push_back({portalIdx, float(path.size()), toTile});
+  }
+  if (startConns.empty() || goalConns.empty())
+    return std::vector<IVec2>();
+
+  constexpr size_t noNode = ~size_t(0);
+  std::vector<float> g(numPortals + 2, std::numeric_limits<float>::max());
+  std::vector<size_t> prev(numPortals + 2, noNode);
+  std::vector<size_t> prevTile(numPortals + 2, noNode);
+  std::vector<bool> closed(numPortals + 2, false);
+  IndexedHeap openList;
+  openList.reset(numPortals + 2);
+  g[startNode] = 0.f;
+  openList.push(startNode, heuristic(from, to));
+
+  auto relax = [&](size_t node, size_t next, float score, size_t tidx, float h)
+  {
+    const float gScore = g[node] + score;
+    if (closed[next] || !(gScore < g[next]))
+      return;
+    g[next] = gScore;
+    prev[next] = node;
+    prevTile[next] = tidx;
+    openList.push(next, gScore + h);
+  };
+  while (!openList.empty())
+  {
+    const size_t node = openList.pop();
+    if (node == goalNode)
+      break;
+    closed[node] = true;
+    const std::vector<PortalConnection> &conns = node == startNode ? startConns : dp.portals[node].conns;
+    for (const PortalConnection &conn : conns)
+      relax(node, conn.connIdx, conn.score, conn.tileIdx, portal_heuristic(dp.portals[conn.connIdx], to));
+    for (const PortalConnection &conn : goalConns)
+      if (conn.connIdx == node)
+        relax(node, goalNode, conn.score, conn.tileIdx, 0.f);
+  }
+  if (prev[goalNode] == noNode)
+    return std::vector<IVec2>();
+
+  std::vector<size_t> nodes;
+  for (size_t node = goalNode; node != startNode; node = prev[node])
+    nodes.push_back(node);
+  std::reverse(nodes.begin(), nodes.end());
+
+  // refine: walk the chosen portals super tile by super tile
+  std::vector<IVec2> res = {from};
+  for (size_t node : nodes)
+  {
+    const size_t tidx = prevTile[node];
+    IVec2 cur = res.back();
+    if (super_tile_idx(dd, dp, cur) != tidx)
+    {
+      // previous portal left us on its other side, step over the border
+      const IVec2 neighbours[4] = {{cur.x + 1, cur.y}, {cur.x - 1, cur.y}, {cur.x, cur.y + 1}, {cur.x, cur.y - 1}};
+      for (const IVec2 &n : neighbours)
+        if (isWalkable(n) && n.x < coveredX && n.y < coveredY && super_tile_idx(dd, dp, n) == tidx)
         {
-          PathPortal &firstPortal = portals[indices[i]];
-          for (size_t j = i + 1; j < indices.size(); ++j)
-          {
-            PathPortal &secondPortal = portals[indices[j]];
-            // check path from i to j
-            // check each position (to find closest dist) (could be made more optimal)
-            bool noPath = false;
-            size_t minDist = 0xffffffff;
-            for (size_t fromY = std::max(firstPortal.startY, size_t(limMin.y));
-                        fromY <= std::min(firstPortal.endY, size_t(limMax.y - 1)) && !noPath; ++fromY)
-            {
-              for (size_t fromX = std::max(firstPortal.startX, size_t(limMin.x));
-                          fromX <= std::min(firstPortal.endX, size_t(limMax.x - 1)) && !noPath; ++fromX)
-              {
-                for (size_t toY = std::max(secondPortal.startY, size_t(limMin.y));
-                            toY <= std::min(secondPortal.endY, size_t(limMax.y - 1)) && !noPath; ++toY)
-                {
-                  for (size_t toX = std::max(secondPortal.startX, size_t(limMin.x));
-                              toX <= std::min(secondPortal.endX, size_t(limMax.x - 1)) && !noPath; ++toX)
-                  {
-                    IVec2 from{int(fromX), int(fromY)};
-                    IVec2 to{int(toX), int(toY)};
-                    std::vector<IVec2> path = find_path_a_star(dd, from, to, limMin, limMax);
-                    if (path.empty() && from != to)
-                    {
-                      noPath = true; // if we found that there's no path at all - we can break out
-                      break;
-                    }
-                    minDist = std::min(minDist, path.size());
-                  }
-                }
-              }
-            }
-            // write pathable data and length
-            if (noPath)
-              continue;
-            firstPortal.conns.push_back({indices[j], float(minDist)});
-            secondPortal.conns.push_back({indices[i], float(minDist)});
-          }
+          cur = n;
+          break;
         }
-      }
-      e.set(DungeonPortals{splitTiles, portals, tilePortalsIndices});
-    });
-  });
+      res.push_back(cur);
+    }
+    IVec2 limMin, limMax;
+    super_tile_limits(dd, dp, tidx, limMin, limMax);
+    std::vector<IVec2> segment = node == goalNode ? find_path_a_star(dd, cur, to, limMin, limMax)
+                                                  : find_path_to_portal(dd, dp, cur, node, tidx);
+    if (segment.empty()) // shouldn't happen with a consistent portal graph
+      return find_path_a_star(dd, from, to, levelMin, levelMax);
+    res.insert(res.end(), segment.begin() + 1, segment.end());
+  }
+  return res;
 }
 
+void bench_find_path(const DungeonData &dd, size_t num_queries)
+{
+  using namespace std::chrono;
+  constexpr size_t splitTiles = 10;
+  const auto buildStart = steady_clock::now();
+  const DungeonPortals dp = build_portals(dd, splitTiles);
+  const double buildMs = duration<double, std::milli>(steady_clock::now() - buildStart).count();
+
+  std::vector<IVec2> floorTiles;
+  for (size_t y = 0; y < dd.height; ++y)
+    for (size_t x = 0; x < dd.width; ++x)
+      if (dd.tiles[y * dd.width + x] != dungeon::wall)
+        floorTiles.push_back(IVec2{int(x), int(y)});
+  if (floorTiles.empty())
+    return;
+
+  double flatMs = 0.0;
+  double hierMs = 0.0;
+  size_t flatLength = 0;
+  size_t hierLength = 0;
+  size_t numFound = 0;
+  size_t numMismatches = 0;
+  for (size_t i = 0; i < num_queries; ++i)
+  {
+    const IVec2 from = floorTiles[size_t(GetRandomValue(0, int(floorTiles.size()) - 1))];
+    const IVec2 to = floorTiles[size_t(GetRandomValue(0, int(floorTiles.size()) - 1))];
+
+    auto start = steady_clock::now();
+    const std::vector<IVec2> flatPath = find_path_a_star(dd, from, to, {0, 0}, {int(dd.width), int(dd.height)});
+    flatMs += duration<double, std::milli>(steady_clock::now() - start).count();
+
+    start = steady_clock::now();
+    const std::vector<IVec2> hierPath = find_path(dd, dp, from, to);
+    hierMs += duration<double, std::milli>(steady_clock::now() - start).count();
+
+    if (flatPath.empty() != hierPath.empty())
+      numMismatches++;
+    else if (!flatPath.empty())
+    {
+      numFound++;
+      flatLength += flatPath.size();
+      hierLength += hierPath.size();
+    }
+  }
+  const double queries = double(std::max(num_queries, size_t(1)));
+  printf("path bench %zux%zu, %zu portals built in %.3f ms\n", dd.width, dd.height, dp.portals.size(), buildMs);
+  printf("  flat A*: %9.3f ms/query\n", flatMs / queries);
+  printf("  HPA*:    %9.3f ms/query\n", hierMs / queries);
+  printf("  %zu paths found, HPA* length %.3f of optimal, %zu queries disagree on reachability\n",
+         numFound, flatLength ? double(hierLength) / double(flatLength) : 1.0, numMismatches);
+}
+
+void rebuild_cluster(flecs::world &ecs, size_t x, size_t y)
+{
+  auto mapQuery = ecs.query<const DungeonData, DungeonPortals>();
+
+  mapQuery.each([&](const DungeonData &dd, DungeonPortals &dp)
+  {
+    rebuild_cluster(dd, dp, x, y);
+  });
+}
@@ -1,11 +1,14 @@
 #pragma once
 #include <flecs.h>
 #include <vector>
+#include "ecsTypes.h"
+#include "math.h"
 
 struct PortalConnection
 {
   size_t connIdx;
   float score;
+  size_t tileIdx; // super tile the connecting path lies in
 };
 
 struct PathPortal
@@ -23,4 +26,15 @@ struct DungeonPortals
 };
 
 void prebuild_map(flecs::world &ecs);
+// call after tile (x, y) changed: recomputes portals on the borders of its super tile
+// and connections of the super tiles whose portals changed, the rest is kept
+void rebuild_cluster(flecs::world &ecs, size_t x, size_t y);
+
+// Hierarchical query: start and goal are linked to the portals of their super tiles,
+// the portal graph is searched and only the chosen segments are refined with local A*.
+// Returns tiles from `from` to `to` inclusive, empty if there's no path.
+std::vector<IVec2> find_path(const DungeonData &dd, const DungeonPortals &dp, IVec2 from, IVec2 to);
+
+// random queries on the level, compares path lengths and timings against flat A*
+void bench_find_path(const DungeonData &dd, size_t num_queries);
 
@@ -6,8 +6,15 @@
 #include "dungeonGen.h"
 #include "dungeonUtils.h"
 #include "pathfinder.h"
+#include "pathRequests.h"
 
 constexpr float tile_size = 64.f;
+constexpr double path_requests_budget_ms = 2.0;
+
+static IVec2 to_tile(const Position &pos)
+{
+  return IVec2{int(floorf(pos.x / tile_size + 0.5f)), int(floorf(pos.y / tile_size + 0.5f))};
+}
 
 static void register_roguelike_systems(flecs::world &ecs)
 {
@@ -71,8 +78,9 @@ static void register_roguelike_systems(flecs::world &ecs)
           constexpr int angRandMax = 1 << 16;
           const float angle = float(GetRandomValue(0, angRandMax)) / float(angRandMax) * PI * 2.f;
           Color col = colors[st];
-          steer::create_steer_beh(create_monster(ecs,
-              {pp.x + cosf(angle) * dist, pp.y + sinf(angle) * dist}, col, "minotaur_tex"), st);
+          const Position spawnPos{pp.x + cosf(angle) * dist, pp.y + sinf(angle) * dist};
+          steer::create_steer_beh(create_monster(ecs, spawnPos, col, "minotaur_tex"), st)
+            .set(PathRequest{to_tile(spawnPos), to_tile(pp)});
           ms.timeToSpawn += ms.timeBetweenSpawns;
         }
       });
@@ -137,6 +145,14 @@ static void register_roguelike_systems(flecs::world &ecs)
         }
       });
     });
+  ecs.system<const PathResult>()
+    .each([&](const PathResult &pr)
+    {
+      for (size_t i = 1; i < pr.path.size(); ++i)
+        DrawLineEx(Vector2{(float(pr.path[i - 1].x) + 0.5f) * tile_size, (float(pr.path[i - 1].y) + 0.5f) * tile_size},
+                   Vector2{(float(pr.path[i].x) + 0.5f) * tile_size, (float(pr.path[i].y) + 0.5f) * tile_size},
+                   2.f, GetColor(0xffff0080));
+    });
   steer::register_systems(ecs);
 }
 
@@ -187,5 +203,6 @@ void init_dungeon(flecs::world &ecs, char *tiles, size_t w, size_t h)
 
 void process_game(flecs::world &ecs)
 {
+  paths::process_requests(ecs, path_requests_budget_ms);
 }
 